@@ -2,25 +2,140 @@
 #define ATTACKS_HPP
 
 #include "board.hpp"
+#include <array>
 
-// External Declaration (No Memory Allocation Yet) of Knight and King Attacks 
-extern U64 knightAttacks[64]; // Knight attacks for each square
-extern U64 kingAttacks[64]; // King attacks for each square
-extern U64 pawnAttacks[2][64]; // Pawn attacks for white and black (0 for white, 1 for black)
+// Masks to prevent wrap around on board edges
+constexpr U64 FILE_A_MASK = 0xFEFEFEFEFEFEFEFEULL; // ~file A
+constexpr U64 FILE_H_MASK = 0x7F7F7F7F7F7F7F7FULL; // ~file H
+constexpr U64 FILE_AB_MASK = 0xFCFCFCFCFCFCFCFCULL; // ~files A&B
+constexpr U64 FILE_GH_MASK = 0x3F3F3F3F3F3F3F3FULL; // ~files G&H
 
-// Pawn Attacks
-void init_pawn_attacks(); // Initialize pawn attacks for both colors
-void init_leaper_attacks(); // Initialize knight and king attacks
+// Leaper and pawn tables are generated by the compiler, so they need no
+// initialisation and lookups into them can be folded at compile time.
+constexpr std::array<U64, 64> make_knight_attacks() {
+    std::array<U64, 64> table{};
+    for (int sq = 0; sq < 64; sq++) {
+        U64 b = 1ULL << sq; // Bitboard for the square
+        U64 knight = 0;
+
+        // Knight Jumps (Done by shifting the bitboard left and right)
+        knight |= (b & FILE_H_MASK) << 17; // 2 up, 1 right
+        knight |= (b & FILE_A_MASK) << 15; // 2 up, 1 left
+        knight |= (b & FILE_GH_MASK) << 10; // 1 up, 2 right
+        knight |= (b & FILE_AB_MASK) << 6;  // 1 up, 2 left
+        knight |= (b & FILE_GH_MASK) >> 6;  // 1 down, 2 right
+        knight |= (b & FILE_AB_MASK) >> 10; // 1 down, 2 left
+        knight |= (b & FILE_H_MASK) >> 15; // 2 down, 1 right
+        knight |= (b & FILE_A_MASK) >> 17; // 2 down, 1 left
+        table[sq] = knight;
+    }
+    return table;
+}
+
+constexpr std::array<U64, 64> make_king_attacks() {
+    std::array<U64, 64> table{};
+    for (int sq = 0; sq < 64; sq++) {
+        U64 b = 1ULL << sq;
+        U64 king = 0;
+
+        // King Moves (Done by shifting the bitboard left and right)
+        king |= (b & FILE_H_MASK) << 1;  // 1 right
+        king |= (b & FILE_A_MASK) >> 1;  // 1 left
+        king |= (b & FILE_H_MASK) << 9;  // 1 up, 1 right
+        king |= (b & FILE_A_MASK) << 7;  // 1 up, 1 left
+        king |= (b & FILE_H_MASK) >> 7;  // 1 down, 1 right
+        king |= (b & FILE_A_MASK) >> 9;  // 1 down, 1 left
+        king |= b << 8;                  // 1 up (shifted off the board on rank 8)
+        king |= b >> 8;                  // 1 down
+        table[sq] = king;
+    }
+    return table;
+}
+
+constexpr std::array<std::array<U64, 64>, 2> make_pawn_attacks() {
+    std::array<std::array<U64, 64>, 2> table{};
+    for (int sq = 0; sq < 64; sq++) {
+        U64 b = 1ULL << sq;
+
+        // White Pawn Attacks (North-East and North-West)
+        table[0][sq] = ((b & FILE_H_MASK) << 9) | ((b & FILE_A_MASK) << 7);
+
+        // Black Pawn Attacks (South-East and South-West)
+        table[1][sq] = ((b & FILE_H_MASK) >> 7) | ((b & FILE_A_MASK) >> 9);
+    }
+    return table;
+}
+
+// Direction from a to b as a (rank, file) step, or {0, 0} if the two squares
+// do not share a rank, file or diagonal
+constexpr bool aligned_step(int a, int b, int &dr, int &df) {
+    int ra = a / 8, fa = a % 8, rb = b / 8, fb = b % 8;
+    dr = (rb > ra) - (rb < ra);
+    df = (fb > fa) - (fb < fa);
+    if (a == b) return false;
+    return ra == rb || fa == fb || (rb - ra == fb - fa) || (rb - ra == fa - fb);
+}
+
+// Squares strictly between a and b when they are aligned, empty otherwise
+constexpr std::array<std::array<U64, 64>, 64> make_between() {
+    std::array<std::array<U64, 64>, 64> table{};
+    for (int a = 0; a < 64; a++) {
+        for (int b = 0; b < 64; b++) {
+            int dr = 0, df = 0;
+            if (!aligned_step(a, b, dr, df)) continue;
+            U64 bb = 0;
+            for (int t = a + dr * 8 + df; t != b; t += dr * 8 + df)
+                bb |= 1ULL << t;
+            table[a][b] = bb;
+        }
+    }
+    return table;
+}
+
+// The full edge-to-edge line through a and b when they are aligned
+constexpr std::array<std::array<U64, 64>, 64> make_line() {
+    std::array<std::array<U64, 64>, 64> table{};
+    for (int a = 0; a < 64; a++) {
+        for (int b = 0; b < 64; b++) {
+            int dr = 0, df = 0;
+            if (!aligned_step(a, b, dr, df)) continue;
+            U64 bb = 1ULL << a;
+            for (int sign = -1; sign <= 1; sign += 2) {
+                int r = a / 8 + sign * dr, f = a % 8 + sign * df;
+                while (r >= 0 && r < 8 && f >= 0 && f < 8) {
+                    bb |= 1ULL << (r * 8 + f);
+                    r += sign * dr;
+                    f += sign * df;
+                }
+            }
+            table[a][b] = bb;
+        }
+    }
+    return table;
+}
+
+inline constexpr std::array<U64, 64> knightAttacks = make_knight_attacks(); // Knight attacks for each square
+inline constexpr std::array<U64, 64> kingAttacks = make_king_attacks(); // King attacks for each square
+inline constexpr std::array<std::array<U64, 64>, 2> pawnAttacks = make_pawn_attacks(); // Pawn attacks for white and black (0 for white, 1 for black)
+inline constexpr std::array<std::array<U64, 64>, 64> between = make_between(); // Squares strictly between two aligned squares
+inline constexpr std::array<std::array<U64, 64>, 64> line = make_line(); // Whole line through two aligned squares
 
 // Sliding Piece Attacks
 U64 rook_attacks(int sq, U64 occ); // Rook attacks for a given square with occupancy
 U64 bishop_attacks(int sq, U64 occ); // Bishop attacks for a given square with occupancy
-inline U64 queen_attacks(int sq, U64 occ) {
-    return rook_attacks(sq, occ) | bishop_attacks(sq, occ); // Queen attacks are a combination of rook and bishop attacks
-}
+U64 queen_attacks(int sq, U64 occ); // Queen attacks are a combination of rook and bishop attacks
 
-// Call once at startup to initialize the attacks
-void init_attacks();
+// Slider lookup kernels. The tables are built during static initialisation,
+// using PEXT when the CPU has BMI2 and magic multiplication otherwise, so one
+// binary runs anywhere. Nothing needs to be called before using them.
+enum SliderBackend {
+    SLIDER_MAGIC,
+    SLIDER_PEXT
+};
 
-#endif // ATTACKS_HPP
+bool pext_supported(); // True if this CPU reports BMI2
+bool set_slider_backend(SliderBackend backend); // Rebuild the tables for a backend, false if unsupported
+SliderBackend slider_backend();
+const char *slider_backend_name(); // Human readable name of the active backend
 
+#endif // ATTACKS_HPP
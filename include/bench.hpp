@@ -0,0 +1,19 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+// Run perft over a fixed set of positions and report nodes per second.
+void perft_bench(int depth);
+
+// Search the positions to a fixed depth and report nodes, time and the
+// share of beta cutoffs produced by the first move (move ordering quality).
+void search_bench(int depth);
+
+// Search the same positions to a fixed depth with 1, 2, 4, 8 and 16 threads
+// and report the time-to-depth speedup over a single thread.
+void smp_bench(int depth);
+
+// Evaluate every position within `depth` plies of the bench positions and
+// report evaluations per second, one by one and in batches.
+void eval_bench(int depth);
+
+#endif // BENCH_HPP
@@ -6,6 +6,7 @@
 #include <array> 
 #include <cctype>
 #include <iostream>
+#include <string>
 
 // Simple struct holding the state to restore
 struct Undo {
@@ -13,6 +14,9 @@ struct Undo {
     bool   w_can_castle_k, w_can_castle_q;
     bool   b_can_castle_k, b_can_castle_q;
     PieceType captured;
+    U64    key;
+    U64    pawnKey;
+    int    psqtScore;
 };
 
 // Board Struct 
@@ -23,6 +27,10 @@ struct Board {
     U64 whiteOccupancy; // Bitboard for white occupied squares
     U64 blackOccupancy; // Bitboard for black occupied squares
 
+    // Piece on each square as piece_index(color, type): positive for white,
+    // negative for black and 0 for an empty square
+    std::array<int8_t, 64> mailbox;
+
     Color sideToMove = WHITE; // By default, white to move (can be changed to black)
     int enPassantSquare = -1;
     bool w_can_castle_k = true; // White can castle kingside
@@ -30,16 +38,84 @@ struct Board {
     bool b_can_castle_k = true; // Black can castle kingside
     bool b_can_castle_q = true; // Black can castle queenside
 
+    U64 key = 0ULL; // Zobrist key, updated incrementally by make_move
+    U64 pawnKey = 0ULL; // Zobrist key of the pawns alone, for the pawn hash
+    int psqtScore = 0; // Material and piece-square score for White, also kept by make_move
+
     // Set up the initial position of the board
     void init_startpos();
 
-    // Recompute the occupancy bitboards
+    // Set up the board from a FEN string (move counters are ignored)
+    void set_fen(const std::string &fen);
+
+    // Recompute the occupancy bitboards, the mailbox, the Zobrist keys and
+    // the material/piece-square score from scratch. Call this after editing the board state by hand.
     void recompute_occupancy();
 
-    // Check square attack 
+    // Castling rights packed into 4 bits (K, Q, k, q)
+    int castling_rights() const {
+        return int(w_can_castle_k) | int(w_can_castle_q) << 1 |
+               int(b_can_castle_k) << 2 | int(b_can_castle_q) << 3;
+    }
+
+    // Full Zobrist key of the current position, used to verify the
+    // incrementally maintained one
+    U64 compute_key() const;
+
+    // Full pawn-only key, used to verify pawnKey
+    U64 compute_pawn_key() const;
+
+    // Full material/piece-square score, used to verify psqtScore
+    int compute_psqt() const;
+
+    // Check square attack. The template has the attacking side fixed at
+    // compile time (instantiated for WHITE and BLACK), the other overload
+    // picks it at run time.
+    template <Color By>
+    bool is_square_attacked(int sq) const;
     bool is_square_attacked(int sq, Color bySide) const;
 
-    PieceType piece_at(int sq, Color &color_out) const;
+    // Every piece of either colour attacking sq, with sliders blocked by occ.
+    // Passing an occupancy with pieces removed reveals x-ray attackers.
+    U64 attackers_to(int sq, U64 occ) const;
+
+    PieceType piece_at(int sq, Color &color_out) const {
+        int p = mailbox[sq];
+        color_out = p > 0 ? WHITE : (p < 0 ? BLACK : BOTH);
+        return static_cast<PieceType>(p < 0 ? -p : p);
+    }
+
+    PieceType piece_type_at(int sq) const {
+        int p = mailbox[sq];
+        return static_cast<PieceType>(p < 0 ? -p : p);
+    }
+
+    // Incremental updates used by make_move/undo_move. Occupancy is kept in
+    // sync with XOR deltas instead of being recomputed from all 12 boards.
+    void put_piece(Color c, PieceType pt, int sq) {
+        U64 bit = 1ULL << sq;
+        bitboards[board_index(c, pt)] ^= bit;
+        (c == WHITE ? whiteOccupancy : blackOccupancy) ^= bit;
+        bothOccupancy ^= bit;
+        mailbox[sq] = static_cast<int8_t>(piece_index(c, pt));
+    }
+
+    void remove_piece(Color c, PieceType pt, int sq) {
+        U64 bit = 1ULL << sq;
+        bitboards[board_index(c, pt)] ^= bit;
+        (c == WHITE ? whiteOccupancy : blackOccupancy) ^= bit;
+        bothOccupancy ^= bit;
+        mailbox[sq] = 0;
+    }
+
+    void move_piece(Color c, PieceType pt, int from, int to) {
+        U64 delta = (1ULL << from) | (1ULL << to);
+        bitboards[board_index(c, pt)] ^= delta;
+        (c == WHITE ? whiteOccupancy : blackOccupancy) ^= delta;
+        bothOccupancy ^= delta;
+        mailbox[to] = mailbox[from];
+        mailbox[from] = 0;
+    }
 
     int king_square(Color c) const;
 };
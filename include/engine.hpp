@@ -3,17 +3,33 @@
 
 #include "board.hpp"
 #include "movegen.hpp"
-#include <unordered_map>
+#include "evalcache.hpp"
+#include "tt.hpp"
+#include <cstddef>
 #include <cstdint>
 
 namespace Engine {
 
 struct SearchResult {
     Move bestMove;
+    MoveList pv;          // principal variation, starting with bestMove
     int score;
     int nodes;
+    int qnodes;           // part of nodes searched in quiescence
+    int betaCutoffs;      // beta cutoffs in the main search (not quiescence)
+    int firstMoveCutoffs; // cutoffs caused by the first move tried, a measure of ordering quality
+    int pawnProbes;       // pawn hash lookups made by the evaluation
+    int pawnHits;         // ... of which found the pawn structure cached
+    int evalCacheHits;    // static evaluations answered by the eval cache
+    int evalCacheMisses;  // ... and computed by evaluate()
+    int lazyEvals;        // ... of which stopped after material, outside the window
+    int moveGenerations;  // generate_moves calls, the move picker makes them only when needed
 };
 
+// Which evaluation evaluate() runs. The network has to be loaded first (see
+// nnue.hpp), until then the classical terms are used.
+enum Evaluator { EVAL_CLASSICAL, EVAL_NNUE };
+
 // Tunable parameters controlling the evaluation function.  They are kept
 // outside of the evaluate() call so tests or front-ends can tweak the engine
 // without recompiling.
@@ -28,12 +44,76 @@ struct EvalParams {
     int pawnBreakBonus      = 10;  // bonus per available pawn break
     int initiativeWeight    = 5;   // side to move forcing move bonus
     int kingSafetyWeight    = 5;   // bonus for king flight squares
+    int lazyMargin          = 1200; // cap on the terms after material+PST, the lazy evaluation margin
+    Evaluator evaluator     = EVAL_CLASSICAL;
 };
 
 extern EvalParams evalParams;
 
+// Where evaluate() takes its weights from. DefaultEval has the defaults as
+// compile-time constants, so they are folded into the code; RuntimeEval reads
+// evalParams, for tuning.
+struct DefaultEval {
+    static constexpr EvalParams params{};
+};
+
+struct RuntimeEval {
+    static constexpr const EvalParams &params = evalParams;
+};
+
+// Options controlling the search itself. The pruning switches exist so each
+// technique can be A/B tested on its own.
+struct SearchOptions {
+    int threads = 1; // Lazy SMP: threads - 1 helpers search alongside the main thread
+    bool nullMove               = true; // null-move pruning (not in check, not with pawns only)
+    bool lateMoveReductions     = true; // reduce late quiet moves, re-search if they beat alpha
+    bool futilityPruning        = true; // skip quiet moves that cannot raise alpha near the leaves
+    bool reverseFutilityPruning = true; // cut nodes whose static eval is far above beta
+    bool lateMovePruning        = true; // skip the last quiet moves near the leaves
+    bool lazyEval               = true; // stand-pat stops after material+PST when far above beta
+};
+
+extern SearchOptions searchOptions;
+
+// Static evaluation from White's side. Uses the DefaultEval instantiation
+// while evalParams holds the defaults and RuntimeEval once they are changed.
 int evaluate(const Board &b);
 
+// Which of the two evaluate() uses is only decided here, not on every call.
+// search() calls it; anything else changing evalParams has to as well.
+void eval_params_changed();
+
+template <class Params>
+int evaluate(const Board &b); // instantiated for DefaultEval and RuntimeEval
+
+// evaluate() for count boards at once, out[i] = evaluate(boards[i]) exactly.
+// Meant for tuning and labelling jobs: the counting terms of four positions
+// are scored together with AVX2 when the CPU has it.
+void evaluate_batch(const Board *boards, size_t count, int *out);
+
+// Lazy evaluation for a window (alpha, beta) seen from White's side. When
+// material and piece-square tables alone are further than
+// evalParams.lazyMargin outside the window the remaining terms are skipped
+// and that bound is returned: at least beta, or at most alpha. Otherwise the
+// result is exactly evaluate(b).
+int evaluate(const Board &b, int alpha, int beta);
+
+// The pawn-structure part of the evaluation is cached in a pawn hash keyed by
+// Board::pawnKey. Every thread has its own table and statistics.
+struct PawnHashStats {
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+};
+
+PawnHashStats pawn_hash_stats(); // statistics of the calling thread
+void clear_pawn_hash();          // empty the calling thread's table and reset its statistics
+
+// Static exchange evaluation: material won (negative if lost) by the side to
+// move after the full exchange sequence that move m starts on its target
+// square, assuming both sides always recapture with their least valuable
+// piece and may stop whenever continuing would lose material.
+int see(const Board &b, Move m);
+
 SearchResult search(Board &board, int maxDepth);
 
 } // namespace Engine
@@ -0,0 +1,44 @@
+#ifndef EVALCACHE_HPP
+#define EVALCACHE_HPP
+
+#include "bitboard.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Engine {
+
+// Cache of static evaluations, consulted by the search before evaluate()
+// runs. Every entry is one packed 64-bit word:
+//   bits  0-23  score (signed, 24 bits)
+//   bits 24-63  upper 40 bits of the Zobrist key (verification)
+// Each key maps to a single slot and a store always replaces it.
+//
+// probe() and store() may be called from several search threads at once.
+// An entry is a single atomic word carrying its own verification bits, so a
+// racing writer can only lose an update, never produce a torn entry.
+// resize() and clear() must not run while a search does.
+struct EvalCache {
+    // Resize to the largest power-of-two number of entries that fits in kb
+    // kilobytes. Clears the cache.
+    void resize(size_t kb);
+    void clear();
+    bool empty() const { return entries.empty(); }
+    size_t size_kb() const;
+
+    bool probe(U64 key, int &score) const;
+    void store(U64 key, int score);
+
+private:
+    std::vector<std::atomic<uint64_t>> entries;
+    U64 mask = 0;
+};
+
+extern EvalCache evalCache;
+
+constexpr size_t DEFAULT_EVAL_CACHE_KB = 1024;
+
+} // namespace Engine
+
+#endif // EVALCACHE_HPP
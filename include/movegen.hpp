@@ -2,31 +2,129 @@
 #define MOVEGEN_HPP
 
 #include "board.hpp"
-#include <vector>
+#include <cassert>
+#include <cstddef>
 #include <string>
 
+// A move packed into 16 bits:
+//   bits  0-5   from square
+//   bits  6-11  to square
+//   bits 12-15  flag: normal, double pawn push, castling, en passant, or
+//               promotion to knight, bishop, rook, queen (4-7)
+// The moving and captured pieces are not stored: piece() and captured() look
+// them up on the board the move is about to be made on. The all-zero move
+// (a1a1) is never legal and stands for "no move".
 struct Move {
-    int from;
-    int to;
-    PieceType piece;
-    PieceType captured;
-    PieceType promotion;
-    bool isDoublePush;
-    bool isEnPassant;
-    bool isCastling;
+    enum Flag {
+        NORMAL = 0,
+        DOUBLE_PUSH = 1,
+        CASTLING = 2,
+        EN_PASSANT = 3,
+        PROMOTION = 4 // + promoted piece type - KNIGHT
+    };
+
+    uint16_t data;
+
+    Move() = default; // uninitialised like a plain struct, Move() is "no move"
+    constexpr Move(int from, int to, int flag = NORMAL)
+        : data(uint16_t(from | to << 6 | flag << 12)) {}
+    static constexpr Move promotion_to(int from, int to, PieceType pt) {
+        return Move(from, to, PROMOTION + pt - KNIGHT);
+    }
+
+    constexpr int from() const { return data & 63; }
+    constexpr int to() const { return (data >> 6) & 63; }
+    constexpr int flag() const { return data >> 12; }
+    constexpr PieceType promotion() const {
+        return flag() >= PROMOTION ? PieceType(flag() - PROMOTION + KNIGHT) : NO_PIECE;
+    }
+    constexpr bool is_double_push() const { return flag() == DOUBLE_PUSH; }
+    constexpr bool is_castling() const { return flag() == CASTLING; }
+    constexpr bool is_en_passant() const { return flag() == EN_PASSANT; }
+    constexpr bool is_none() const { return data == 0; }
+
+    // Only valid before the move is made on b
+    PieceType piece(const Board &b) const { return b.piece_type_at(from()); }
+    PieceType captured(const Board &b) const {
+        return is_en_passant() ? PAWN : b.piece_type_at(to());
+    }
+
+    constexpr bool operator==(Move o) const { return data == o.data; }
+    constexpr bool operator!=(Move o) const { return data != o.data; }
+};
+static_assert(sizeof(Move) == 2, "Move must stay packed into 16 bits");
+
+// Fixed-capacity move list with inline storage so move generation never
+// touches the heap. No legal chess position has more than 218 moves.
+struct MoveList {
+    static constexpr size_t CAPACITY = 256;
+
+    Move moves[CAPACITY];
+    size_t count = 0;
+
+    void push_back(Move m) {
+        assert(count < CAPACITY);
+        moves[count++] = m;
+    }
+    void clear() { count = 0; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    Move &operator[](size_t i) { return moves[i]; }
+    const Move &operator[](size_t i) const { return moves[i]; }
+
+    Move *begin() { return moves; }
+    Move *end() { return moves + count; }
+    const Move *begin() const { return moves; }
+    const Move *end() const { return moves + count; }
 };
 
 // Parse a UCI-style move string (e2e4, e7e8q, etc.) using the current board state
 // to determine move attributes.
 Move parse_move(const std::string &uci, const Board &board);
 
+// UCI string of a move (e2e4, e7e8q, "0000" for no move).
+std::string move_to_uci(Move m);
+
 // Apply a move, returning an Undo structure for later restoration.
-Undo make_move(Board &board, const Move &m);
+Undo make_move(Board &board, Move m);
 
 // Undo a previously made move using the Undo info.
-void undo_move(Board &board, const Move &m, const Undo &u);
+void undo_move(Board &board, Move m, const Undo &u);
+
+// Pass the turn without moving (used by null-move pruning). Must not be
+// called while in check.
+Undo make_null_move(Board &board);
+void undo_null_move(Board &board, const Undo &u);
+
+// What generate_moves emits. All of them produce legal moves only.
+enum GenType {
+    CAPTURES, // captures, en passant and promotions
+    QUIETS,   // everything else, castling included
+    EVASIONS, // every legal move while in check (must be in check)
+    LEGAL     // every legal move, CAPTURES and QUIETS together
+};
+
+// Generate legal moves of the given type for the side to move into a
+// caller-provided list (the list is cleared first).
+template<GenType Type>
+void generate_moves(Board &board, MoveList &moves);
+
+// Generate all legal moves for the current side to move into a
+// caller-provided list (the list is cleared first).
+void generate_legal_moves(Board &board, MoveList &moves);
+
+// Convenience overload returning the list by value.
+MoveList generate_legal_moves(Board &board);
+
+// Whether a move of unknown origin (a transposition table or killer move)
+// can be played in this position. is_pseudo_legal checks the piece, the
+// flags and that the path is clear, everything but leaving the own king in
+// check; is_legal checks that too but needs a pseudo-legal move.
+bool is_pseudo_legal(const Board &board, Move m);
+bool is_legal(const Board &board, Move m);
 
-// Generate all legal moves for the current side to move.
-std::vector<Move> generate_legal_moves(Board &board);
+// Count the leaf nodes of the legal move tree to the given depth.
+uint64_t perft(Board &board, int depth);
 
 #endif // MOVEGEN_HPP
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef MOVEPICK_HPP
+#define MOVEPICK_HPP
+
+#include "movegen.hpp"
+
+namespace Engine {
+
+// Butterfly table of quiet moves that caused cutoffs, by [side][from][to].
+// Scores stay below HISTORY_MAX.
+using HistoryTable = int[2][64][64];
+constexpr int HISTORY_MAX = 500000;
+
+// No capture, en passant or promotion
+inline bool is_quiet(const Board &b, Move m) {
+    return b.mailbox[m.to()] == 0 && !m.is_en_passant() && m.promotion() == NO_PIECE;
+}
+
+// Hands out the legal moves of a node one at a time, best first. Each group
+// is only generated once the one before it is used up, so when an early
+// move cuts off the rest is never generated:
+//   1. the TT move, checked with is_pseudo_legal/is_legal instead of generated
+//   2. captures and promotions that do not lose material (SEE >= 0), by MVV-LVA
+//   3. the two killers, checked like the TT move
+//   4. quiet moves by history
+//   5. the losing captures put aside in 2
+// In check every evasion is generated at once after the TT move, captures
+// by MVV-LVA, then killers, then history. The quiescence picker only hands
+// out the captures of stage 2.
+//
+// generations counts the generate_moves calls, for the search statistics.
+class MovePicker {
+public:
+    MovePicker(Board &b, Move ttMove, const Move *killers, const HistoryTable &history,
+               bool inCheck, int &generations);
+    MovePicker(Board &b, int &generations); // quiescence
+
+    Move next(); // Move() once every move has been handed out
+
+    // Whether the last move came from stage 4, the plain quiet moves
+    bool quiet_stage() const { return stage == STAGE_QUIETS; }
+
+private:
+    enum Stage {
+        STAGE_MAIN_TT, STAGE_GEN_CAPTURES, STAGE_GOOD_CAPTURES, STAGE_KILLERS,
+        STAGE_GEN_QUIETS, STAGE_QUIETS, STAGE_BAD_CAPTURES,
+        STAGE_EVASION_TT, STAGE_GEN_EVASIONS, STAGE_EVASIONS,
+        STAGE_QS_GEN_CAPTURES, STAGE_QS_CAPTURES,
+        STAGE_DONE
+    };
+
+    bool playable(Move m) const;
+    void score_captures();
+    void score_quiets();
+    void score_evasions();
+    Move pick_best();
+
+    Board &b;
+    Stage stage;
+    Move ttMove;
+    Move killers[2] = {};
+    const HistoryTable *history = nullptr;
+    int &generations;
+    MoveList moves;
+    MoveList badCaptures;
+    int scores[MoveList::CAPACITY];
+    size_t cur = 0;
+};
+
+} // namespace Engine
+
+#endif // MOVEPICK_HPP
@@ -0,0 +1,79 @@
+#ifndef NNUE_HPP
+#define NNUE_HPP
+
+#include "piece.hpp"
+#include <cstdint>
+#include <string>
+
+struct Board;
+struct Move;
+
+// Efficiently updatable neural network evaluation.
+//
+// Network: 768 -> 2x256 -> 1. Every (colour, piece type, square) is an input
+// feature, seen from both sides: from White's side as is, from Black's side
+// with colours swapped and the board rotated, so both halves share one set
+// of feature weights. Each side has an int16 accumulator holding the bias
+// plus the weights of its active features. The search keeps one per ply of
+// the line it is on, each derived from its parent with update(), so
+// evaluating there only runs the output layer:
+//   score = (sum_i crelu(us[i]) * w[i] + sum_i crelu(them[i]) * w[256+i] + bias) / divisor
+// with crelu clamping to [0, 255]. The score is from the side to move.
+//
+// Network file, all values little-endian:
+//   char    magic[4]     "CENN"
+//   uint32  version      1
+//   uint32  inputs       768
+//   uint32  hidden       256
+//   int32   outputBias
+//   int32   outputDivisor
+//   int16   featureWeights[768][256]
+//   int16   featureBias[256]
+//   int16   outputWeights[512]   side to move first
+namespace NNUE {
+
+constexpr int INPUTS = 768;
+constexpr int HIDDEN = 256;
+constexpr int QA = 255; // clipped ReLU ceiling
+
+struct alignas(32) Accumulator {
+    int16_t values[2][HIDDEN]; // seen from White [0] and from Black [1]
+};
+
+bool load(const std::string &path); // false if the file is missing or malformed, the old network stays
+bool save(const std::string &path);
+void init_psqt_network(); // network reproducing Board::psqtScore, a starting point for training
+void unload(); // back to no network, the classical evaluation
+bool loaded();
+uint32_t generation(); // changes with every network loaded or unloaded
+
+// Accumulator maintenance. refresh() rebuilds from the board; update()
+// gives next for the position b reached by m (which took captured, as in
+// Undo) from acc of the position before it; the others apply one piece
+// change to both sides.
+void refresh(const Board &b, Accumulator &acc);
+void update(const Accumulator &acc, Accumulator &next, const Board &b, Move m, PieceType captured);
+void add_piece(Accumulator &acc, Color c, PieceType pt, int sq);
+void remove_piece(Accumulator &acc, Color c, PieceType pt, int sq);
+void move_piece(Accumulator &acc, Color c, PieceType pt, int from, int to);
+
+// From the side to move, needs loaded(). Without accumulators for b they
+// are built from scratch first.
+int evaluate(const Board &b, const Accumulator &acc);
+int evaluate(const Board &b);
+
+// SIMD kernels, picked at startup from what the CPU supports like the slider
+// backends in attacks.hpp
+enum Backend {
+    BACKEND_SCALAR,
+    BACKEND_SSE2,
+    BACKEND_AVX2
+};
+
+bool set_backend(Backend backend); // false if this CPU does not support it
+Backend backend();
+const char *backend_name();
+
+} // namespace NNUE
+
+#endif // NNUE_HPP
@@ -18,11 +18,11 @@ enum PieceType {
     NO_PIECE = 0
 };
 
-inline int piece_index(Color c, PieceType pt) {
+constexpr int piece_index(Color c, PieceType pt) {
     return pt * c; 
 }
 
-inline int board_index(Color c, PieceType pt) {
+constexpr int board_index(Color c, PieceType pt) {
     return (c == WHITE ? (pt - 1) : ((pt - 1) + 6));
 }
 
@@ -0,0 +1,74 @@
+#ifndef TT_HPP
+#define TT_HPP
+
+#include "bitboard.hpp"
+#include "movegen.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Engine {
+
+enum Bound { BOUND_NONE = 0, BOUND_UPPER = 1, BOUND_LOWER = 2, BOUND_EXACT = 3 };
+
+struct TTData {
+    int depth;
+    Bound bound;
+    int score;
+    Move move;
+};
+
+// Fixed-size transposition table made of cache-line sized buckets. Every
+// entry is one packed 64-bit word:
+//   bits  0-15  upper 16 bits of the Zobrist key (verification)
+//   bits 16-31  best move (Move::data)
+//   bits 32-50  score (signed, 19 bits)
+//   bits 51-57  depth
+//   bits 58-59  bound
+//   bits 60-63  generation of the search that stored it
+// The table persists across searches; stale entries are aged out through
+// the generation counter instead of clearing the table.
+//
+// probe() and store() may be called from several search threads at once.
+// Each entry is a single atomic word carrying its own verification bits, so
+// a racing writer can only lose an update, never produce a torn entry.
+// resize(), clear() and new_search() must not run while a search does.
+struct TranspositionTable {
+    static constexpr int BUCKET_ENTRIES = 8;
+    struct alignas(64) Bucket {
+        std::atomic<uint64_t> entries[BUCKET_ENTRIES];
+    };
+
+    // Resize to the largest power-of-two number of buckets that fits in mb
+    // megabytes. Clears the table.
+    void resize(size_t mb);
+    void clear();
+    bool empty() const { return buckets.empty(); }
+    size_t size_mb() const;
+
+    // Call once at the start of every search to age older entries
+    void new_search();
+
+    bool probe(U64 key, TTData &out) const;
+    void store(U64 key, int depth, Bound bound, int score, Move move);
+
+    // Permille of sampled entries written during the current search
+    int hashfull() const;
+
+private:
+    Bucket &bucket(U64 key) { return buckets[key & mask]; }
+    const Bucket &bucket(U64 key) const { return buckets[key & mask]; }
+
+    std::vector<Bucket> buckets;
+    U64 mask = 0;
+    uint8_t generation = 0;
+};
+
+extern TranspositionTable tt;
+
+constexpr size_t DEFAULT_HASH_MB = 16;
+
+} // namespace Engine
+
+#endif // TT_HPP
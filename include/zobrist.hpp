@@ -0,0 +1,49 @@
+#ifndef ZOBRIST_HPP
+#define ZOBRIST_HPP
+
+#include "bitboard.hpp"
+#include <array>
+
+// Zobrist hashing keys. They come from a fixed-seed splitmix64 generator at
+// compile time, so a position hashes to the same key in every build.
+constexpr U64 zobrist_next(U64 &state) {
+    U64 z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+struct ZobristKeys {
+    std::array<std::array<U64, 64>, 12> piece{}; // indexed by board_index and square
+    std::array<U64, 16> castling{}; // indexed by castling_rights()
+    std::array<U64, 8> epFile{};
+    U64 side = 0; // XORed in when black is to move
+    U64 pawnBase = 0; // seeds the pawn key, so no pawn structure hashes to 0
+};
+
+constexpr ZobristKeys make_zobrist_keys() {
+    ZobristKeys keys{};
+    U64 state = 0x2545F4914F6CDD1DULL;
+    for (auto &table : keys.piece)
+        for (auto &k : table)
+            k = zobrist_next(state);
+
+    // One key per right, combined so any set of rights costs a single XOR
+    U64 rights[4] = {};
+    for (auto &k : rights)
+        k = zobrist_next(state);
+    for (int mask = 0; mask < 16; mask++)
+        for (int r = 0; r < 4; r++)
+            if (mask & (1 << r))
+                keys.castling[mask] ^= rights[r];
+
+    for (auto &k : keys.epFile)
+        k = zobrist_next(state);
+    keys.side = zobrist_next(state);
+    keys.pawnBase = zobrist_next(state);
+    return keys;
+}
+
+inline constexpr ZobristKeys zobrist = make_zobrist_keys();
+
+#endif // ZOBRIST_HPP
@@ -1,61 +1,14 @@
 #include "attacks.hpp"
 
-U64 knightAttacks[64];
-U64 kingAttacks[64];
-U64 pawnAttacks[2][64];
-
-// Masks to prevent wrap around on board edges
-constexpr U64 FILE_A_MASK = 0xFEFEFEFEFEFEFEFEULL; // ~file A
-constexpr U64 FILE_H_MASK = 0x7F7F7F7F7F7F7F7FULL; // ~file H
-constexpr U64 FILE_AB_MASK = 0xFCFCFCFCFCFCFCFCULL; // ~files A&B
-constexpr U64 FILE_GH_MASK = 0x3F3F3F3F3F3F3F3FULL; // ~files G&H
-
-void init_attacks() {
-    init_leaper_attacks(); // Initialize knight and king attacks
-    init_pawn_attacks();    // Initialize pawn attacks
-}
-
-void init_leaper_attacks() {
-    for (int sq = 0; sq < 64; sq++) {
-        U64 b = 1ULL << sq; // Bitboard for the square
-        U64 knight = 0, king = 0;
-
-        // Knight Jumps (Done by shifting the bitboard left and right)
-        knight |= (b & FILE_H_MASK) << 17; // 2 up, 1 right
-        knight |= (b & FILE_A_MASK) << 15; // 2 up, 1 left
-        knight |= (b & FILE_GH_MASK) << 10; // 1 up, 2 right
-        knight |= (b & FILE_AB_MASK) << 6;  // 1 up, 2 left
-        knight |= (b & FILE_GH_MASK) >> 6;  // 1 down, 2 right
-        knight |= (b & FILE_AB_MASK) >> 10; // 1 down, 2 left
-        knight |= (b & FILE_H_MASK) >> 15; // 2 down, 1 right
-        knight |= (b & FILE_A_MASK) >> 17; // 2 down, 1 left
-        knightAttacks[sq] = knight;
-
-        // King Moves (Done by shifting the bitboard left and right)
-        king |= (b & FILE_H_MASK) << 1;  // 1 right
-        king |= (b & FILE_A_MASK) >> 1;  // 1 left
-        king |= (b & FILE_H_MASK) << 9;  // 1 up, 1 right
-        king |= (b & FILE_A_MASK) << 7;  // 1 up, 1 left
-        king |= (b & FILE_H_MASK) >> 7;  // 1 down, 1 right
-        king |= (b & FILE_A_MASK) >> 9;  // 1 down, 1 left
-        if (sq + 8 < 64) king |= 1ULL << (sq + 8);   // 1 up
-        if (sq >= 8)     king |= 1ULL << (sq - 8);   // 1 down
-        kingAttacks[sq] = king;
-    }
-}
-
-void init_pawn_attacks() {
-    for (int sq = 0; sq < 64; sq++) {
-        U64 b = 1ULL << sq; 
-
-        // White Pawn Attacks (North-East and North-West)
-        pawnAttacks[0][sq] = ((b & FILE_H_MASK) << 9) | ((b & FILE_A_MASK) << 7);
-
-        // Black Pawn Attacks (South-East and South-West)
-        pawnAttacks[1][sq] = ((b & FILE_H_MASK) >> 7) | ((b & FILE_A_MASK) >> 9);
-    }
-}
+// The PEXT kernels need an x86-64 compiler that understands target attributes
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CHESS_HAS_PEXT 1
+#else
+#define CHESS_HAS_PEXT 0
+#endif
 
+// Reference ray walker, only used to fill the magic tables at startup
 static U64 sliding_attacks(int sq, U64 occ,
                            const int dr[], const int df[], int dirCount) {
     U64 attacks = 0ULL;
@@ -78,16 +31,182 @@ static U64 sliding_attacks(int sq, U64 occ,
     return attacks;
 }
 
+// Directions for Rook: N, E, S, W
+static const int rookDr[4] = {1, 0, -1, 0};
+static const int rookDf[4] = {0, 1, 0, -1};
+// Directions for Bishop: NE, SE, SW, NW
+static const int bishopDr[4] = {1, -1, -1, 1};
+static const int bishopDf[4] = {1, 1, -1, -1};
+
+// Fancy magic bitboards. For every square we keep the relevant occupancy
+// mask (the rays without the board edge), a magic multiplier that maps every
+// subset of the mask to a unique index, and a pointer into one shared table.
+struct Magic {
+    U64 mask;
+    U64 magic;
+    U64 *attacks;
+    unsigned shift;
+
+    unsigned index(U64 occ) const {
+        return unsigned(((occ & mask) * magic) >> shift);
+    }
+};
+
+static Magic rookMagics[64];
+static Magic bishopMagics[64];
+static U64 rookTable[0x19000];  // sum of 2^bits(mask) over all squares
+static U64 bishopTable[0x1480];
+
+static SliderBackend activeBackend = SLIDER_MAGIC;
+
+// xorshift64* generator, seeded per rank so the tables are reproducible and
+// the search for magics finishes quickly
+static U64 magic_rand(U64 &state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+// Fill the masks and the shared table for one slider type. With PEXT the
+// index of an occupancy is simply its extracted bits, which is exactly the
+// order the Carry-Rippler loop enumerates subsets in, so no magic is needed.
+static void init_magics(Magic magics[], U64 table[], const int dr[], const int df[], bool pext) {
+    U64 occupancy[4096], reference[4096];
+    int epoch[4096] = {0};
+    int attempt = 0;
+    static const U64 seeds[8] = {728, 10316, 55013, 32803, 12281, 15100, 16645, 255};
+    U64 *next = table;
+
+    for (int sq = 0; sq < 64; sq++) {
+        int r = sq / 8, f = sq % 8;
+        // Edges only matter when the piece is not standing on them
+        U64 edges = ((0x00000000000000FFULL | 0xFF00000000000000ULL) & ~(0xFFULL << (8 * r))) |
+                    ((0x0101010101010101ULL | 0x8080808080808080ULL) & ~(0x0101010101010101ULL << f));
+
+        Magic &m = magics[sq];
+        m.mask = sliding_attacks(sq, 0ULL, dr, df, 4) & ~edges;
+        m.shift = 64 - __builtin_popcountll(m.mask);
+        m.magic = 0ULL;
+        m.attacks = next;
+
+        // Enumerate every subset of the mask (Carry-Rippler trick)
+        int size = 0;
+        U64 b = 0ULL;
+        do {
+            occupancy[size] = b;
+            reference[size] = sliding_attacks(sq, b, dr, df, 4);
+            size++;
+            b = (b - m.mask) & m.mask;
+        } while (b);
+        next += size;
+
+        if (pext) {
+            for (int i = 0; i < size; ++i)
+                m.attacks[i] = reference[i];
+            continue;
+        }
+
+        // Try sparse random candidates until one maps without destructive collisions
+        U64 seed = seeds[r];
+        for (int i = 0; i < size;) {
+            do {
+                m.magic = magic_rand(seed) & magic_rand(seed) & magic_rand(seed);
+            } while (__builtin_popcountll((m.magic * m.mask) >> 56) < 6);
+
+            ++attempt;
+            for (i = 0; i < size; ++i) {
+                unsigned idx = m.index(occupancy[i]);
+                if (epoch[idx] < attempt) {
+                    epoch[idx] = attempt;
+                    m.attacks[idx] = reference[i];
+                } else if (m.attacks[idx] != reference[i]) {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+#if CHESS_HAS_PEXT
+// BMI2 kernels. They are compiled for BMI2 only, so they must never be
+// called unless the CPU reported support for it at startup.
+__attribute__((target("bmi2")))
+static U64 rook_attacks_pext(int sq, U64 occ) {
+    const Magic &m = rookMagics[sq];
+    return m.attacks[_pext_u64(occ, m.mask)];
+}
+
+__attribute__((target("bmi2")))
+static U64 bishop_attacks_pext(int sq, U64 occ) {
+    const Magic &m = bishopMagics[sq];
+    return m.attacks[_pext_u64(occ, m.mask)];
+}
+
+__attribute__((target("bmi2")))
+static U64 queen_attacks_pext(int sq, U64 occ) {
+    const Magic &r = rookMagics[sq];
+    const Magic &b = bishopMagics[sq];
+    return r.attacks[_pext_u64(occ, r.mask)] | b.attacks[_pext_u64(occ, b.mask)];
+}
+#endif
+
 U64 rook_attacks(int sq, U64 occ) {
-    // Directions for Rook: N, E, S, W
-    static const int dr[4] = {1, 0, -1, 0};
-    static const int df[4] = {0, 1, 0, -1};
-    return sliding_attacks(sq, occ, dr, df, 4);
+#if CHESS_HAS_PEXT
+    if (activeBackend == SLIDER_PEXT)
+        return rook_attacks_pext(sq, occ);
+#endif
+    const Magic &m = rookMagics[sq];
+    return m.attacks[m.index(occ)];
 }
 
 U64 bishop_attacks(int sq, U64 occ) {
-    // Directions for Bishop: NE, SE, SW, NW
-    static const int dr[4] = {1, -1, -1, 1};
-    static const int df[4] = {1, 1, -1, -1};
-    return sliding_attacks(sq, occ, dr, df, 4);
+#if CHESS_HAS_PEXT
+    if (activeBackend == SLIDER_PEXT)
+        return bishop_attacks_pext(sq, occ);
+#endif
+    const Magic &m = bishopMagics[sq];
+    return m.attacks[m.index(occ)];
+}
+
+U64 queen_attacks(int sq, U64 occ) {
+#if CHESS_HAS_PEXT
+    if (activeBackend == SLIDER_PEXT)
+        return queen_attacks_pext(sq, occ);
+#endif
+    const Magic &r = rookMagics[sq];
+    const Magic &b = bishopMagics[sq];
+    return r.attacks[r.index(occ)] | b.attacks[b.index(occ)];
+}
+
+bool pext_supported() {
+#if CHESS_HAS_PEXT
+    __builtin_cpu_init(); // needed when called from a static initialiser
+    return __builtin_cpu_supports("bmi2");
+#else
+    return false;
+#endif
+}
+
+bool set_slider_backend(SliderBackend backend) {
+    if (backend == SLIDER_PEXT && !pext_supported())
+        return false;
+    bool pext = backend == SLIDER_PEXT;
+    init_magics(rookMagics, rookTable, rookDr, rookDf, pext);
+    init_magics(bishopMagics, bishopTable, bishopDr, bishopDf, pext);
+    activeBackend = backend;
+    return true;
+}
+
+SliderBackend slider_backend() {
+    return activeBackend;
 }
+
+const char *slider_backend_name() {
+    return activeBackend == SLIDER_PEXT ? "pext (BMI2)" : "magic";
+}
+
+// Build the slider tables before main() runs, picking the fastest kernel
+// this host supports. No other static initialiser may use slider attacks.
+static const bool sliderTablesReady =
+    set_slider_backend(pext_supported() ? SLIDER_PEXT : SLIDER_MAGIC);
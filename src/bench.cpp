@@ -0,0 +1,158 @@
+#include "bench.hpp"
+#include "board.hpp"
+#include "movegen.hpp"
+#include "engine.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Standard perft positions (start position, "Kiwipete" and friends)
+static const char *benchPositions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+};
+
+void perft_bench(int depth) {
+    uint64_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const char *fen : benchPositions) {
+        Board b;
+        b.set_fen(fen);
+        uint64_t nodes = perft(b, depth);
+        total += nodes;
+        std::cout << fen << "\n  perft(" << depth << ") = " << nodes << "\n";
+    }
+    auto end = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(end - start).count();
+    std::cout << "Total nodes: " << total << "\n"
+              << "Time: " << secs << " s\n"
+              << "Nodes/second: " << static_cast<uint64_t>(total / (secs > 0 ? secs : 1e-9)) << "\n";
+}
+
+void search_bench(int depth) {
+    uint64_t nodes = 0, qnodes = 0, cutoffs = 0, firstMove = 0, pawnProbes = 0, pawnHits = 0, evalHits = 0, evalMisses = 0, lazy = 0, generations = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const char *fen : benchPositions) {
+        Board b;
+        b.set_fen(fen);
+        Engine::tt.clear();
+        Engine::clear_pawn_hash();
+        Engine::evalCache.clear();
+        auto res = Engine::search(b, depth);
+        nodes += res.nodes;
+        qnodes += res.qnodes;
+        cutoffs += res.betaCutoffs;
+        firstMove += res.firstMoveCutoffs;
+        pawnProbes += res.pawnProbes;
+        pawnHits += res.pawnHits;
+        evalHits += res.evalCacheHits;
+        evalMisses += res.evalCacheMisses;
+        lazy += res.lazyEvals;
+        generations += res.moveGenerations;
+        std::cout << fen << "\n  depth " << depth << ": score " << res.score
+                  << ", nodes " << res.nodes << "\n";
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Total nodes: " << nodes << "\n"
+              << "Time: " << secs << " s\n"
+              << "Nodes/second: " << static_cast<uint64_t>(nodes / (secs > 0 ? secs : 1e-9)) << "\n"
+              << "Quiescence share: " << (nodes ? 100.0 * qnodes / nodes : 0.0) << "%\n"
+              << "First-move cutoff rate: " << (cutoffs ? 100.0 * firstMove / cutoffs : 0.0) << "%\n"
+              << "Pawn hash hit rate: " << (pawnProbes ? 100.0 * pawnHits / pawnProbes : 0.0) << "%\n"
+              << "Eval cache hit rate: " << (evalHits + evalMisses ? 100.0 * evalHits / (evalHits + evalMisses) : 0.0) << "%\n"
+              << "Lazy evaluations: " << (evalMisses ? 100.0 * lazy / evalMisses : 0.0) << "% of cache misses\n"
+              << "Move generations per node: " << (nodes ? double(generations) / nodes : 0.0) << "\n";
+}
+
+void smp_bench(int depth) {
+    const int threadCounts[] = {1, 2, 4, 8, 16};
+    int saved = Engine::searchOptions.threads;
+    double baseline = 0;
+    std::cout << "Time to depth " << depth << " (hardware threads: "
+              << std::thread::hardware_concurrency() << ")\n";
+    for (int threads : threadCounts) {
+        Engine::searchOptions.threads = threads;
+        uint64_t nodes = 0;
+        double secs = 0;
+        for (const char *fen : benchPositions) {
+            Board b;
+            b.set_fen(fen);
+            // every run starts from empty tables and caches
+            Engine::tt.clear();
+            Engine::clear_pawn_hash();
+            Engine::evalCache.clear();
+            auto start = std::chrono::steady_clock::now();
+            nodes += Engine::search(b, depth).nodes;
+            secs += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        if (threads == 1) baseline = secs;
+        std::cout << "  threads " << threads << ": " << secs << " s, "
+                  << nodes << " nodes, speedup " << baseline / (secs > 0 ? secs : 1e-9) << "x\n";
+    }
+    Engine::searchOptions.threads = saved;
+}
+
+// Every position reachable from the bench positions within `depth` plies
+static void collect_positions(Board &b, int depth, std::vector<Board> &out) {
+    out.push_back(b);
+    if (depth == 0) return;
+    MoveList moves;
+    generate_legal_moves(b, moves);
+    for (Move m : moves) {
+        Undo u = make_move(b, m);
+        collect_positions(b, depth - 1, out);
+        undo_move(b, m, u);
+    }
+}
+
+void eval_bench(int depth) {
+    std::vector<Board> positions;
+    for (const char *fen : benchPositions) {
+        Board b;
+        b.set_fen(fen);
+        collect_positions(b, depth, positions);
+    }
+    // Repeat small sets so the timing covers at least a million evaluations
+    size_t rounds = positions.empty() ? 1 : 1 + 1000000 / positions.size();
+    long long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; r++)
+        for (const Board &b : positions)
+            checksum += Engine::evaluate(b);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t evals = rounds * positions.size();
+    std::cout << "Positions: " << positions.size() << " (" << rounds << " rounds, checksum " << checksum << ")\n"
+              << "Time: " << secs << " s\n"
+              << "Evals/second: " << static_cast<uint64_t>(evals / (secs > 0 ? secs : 1e-9)) << "\n";
+
+    // The same through evaluate_batch(), which must give the same checksum
+    std::vector<int> scores(positions.size());
+    long long batchChecksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        Engine::evaluate_batch(positions.data(), positions.size(), scores.data());
+        for (int s : scores) batchChecksum += s;
+    }
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Batch checksum " << batchChecksum << (batchChecksum == checksum ? " (matches)" : " (MISMATCH)") << "\n"
+              << "Batch evals/second: " << static_cast<uint64_t>(evals / (secs > 0 ? secs : 1e-9)) << "\n";
+
+    // Weights folded in at compile time against weights read from evalParams
+    auto timeEvaluator = [&](const char *name, int (*eval)(const Board &)) {
+        auto t0 = std::chrono::steady_clock::now();
+        long long sum = 0;
+        for (size_t r = 0; r < rounds; r++)
+            for (const Board &b : positions)
+                sum += eval(b);
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << name << " evals/second: " << static_cast<uint64_t>(evals / (s > 0 ? s : 1e-9))
+                  << " (checksum " << sum << ")\n";
+    };
+    timeEvaluator("DefaultEval", Engine::evaluate<Engine::DefaultEval>);
+    timeEvaluator("RuntimeEval", Engine::evaluate<Engine::RuntimeEval>);
+}
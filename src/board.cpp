@@ -1,6 +1,8 @@
 #include "board.hpp"
 #include "attacks.hpp"
+#include "psqt.hpp"
 #include "util.hpp"
+#include "zobrist.hpp"
 #include <initializer_list>
 #include <cassert>
 #include <fstream>
@@ -87,6 +89,54 @@ void Board::init_startpos() {
 
 }
 
+void Board::set_fen(const std::string &fen) {
+    for (auto &bb : bitboards) {
+        bb = 0ULL;
+    }
+
+    std::istringstream ss(fen);
+    std::string placement, side, castling, ep;
+    ss >> placement >> side >> castling >> ep;
+
+    // Piece placement, starting from a8 and working down to h1
+    int rank = 7, file = 0;
+    for (char ch : placement) {
+        if (ch == '/') {
+            rank--;
+            file = 0;
+        } else if (std::isdigit(static_cast<unsigned char>(ch))) {
+            file += ch - '0';
+        } else {
+            Color c = std::isupper(static_cast<unsigned char>(ch)) ? WHITE : BLACK;
+            PieceType pt = NO_PIECE;
+            switch (std::tolower(static_cast<unsigned char>(ch))) {
+                case 'p': pt = PAWN; break;
+                case 'n': pt = KNIGHT; break;
+                case 'b': pt = BISHOP; break;
+                case 'r': pt = ROOK; break;
+                case 'q': pt = QUEEN; break;
+                case 'k': pt = KING; break;
+            }
+            if (pt != NO_PIECE)
+                set_bit(bitboards[board_index(c, pt)], sq_index(file, rank));
+            file++;
+        }
+    }
+
+    sideToMove = (side == "b") ? BLACK : WHITE;
+
+    w_can_castle_k = castling.find('K') != std::string::npos;
+    w_can_castle_q = castling.find('Q') != std::string::npos;
+    b_can_castle_k = castling.find('k') != std::string::npos;
+    b_can_castle_q = castling.find('q') != std::string::npos;
+
+    enPassantSquare = -1;
+    if (ep.size() == 2)
+        enPassantSquare = sq_index(ep[0], ep[1]);
+
+    recompute_occupancy();
+}
+
 void Board::recompute_occupancy() {
     // Clear occupancy bitboards
     bothOccupancy = 0ULL;
@@ -101,55 +151,109 @@ void Board::recompute_occupancy() {
 
     bothOccupancy = whiteOccupancy | blackOccupancy;
 
+    // Rebuild the mailbox
+    mailbox.fill(0);
+    for (Color c : {WHITE, BLACK}) {
+        for (int pt = PAWN; pt <= KING; pt++) {
+            U64 bb = bitboards[board_index(c, PieceType(pt))];
+            while (bb) {
+                mailbox[pop_lsb(bb)] = static_cast<int8_t>(piece_index(c, PieceType(pt)));
+            }
+        }
+    }
+
+    key = compute_key();
+    pawnKey = compute_pawn_key();
+    psqtScore = compute_psqt();
 }
 
-bool Board::is_square_attacked(int sq, Color bySide) const {
-    if (bySide == WHITE) {
-        if (pawnAttacks[1][sq] & bitboards[board_index(WHITE, PAWN)])
-            return true;
-    } else {
-        if (pawnAttacks[0][sq] & bitboards[board_index(BLACK, PAWN)]) return true;
+U64 Board::compute_key() const {
+    U64 k = 0ULL;
+    for (int i = 0; i < 12; i++) {
+        U64 bb = bitboards[i];
+        while (bb) {
+            k ^= zobrist.piece[i][pop_lsb(bb)];
+        }
+    }
+    k ^= zobrist.castling[castling_rights()];
+    if (enPassantSquare != -1)
+        k ^= zobrist.epFile[enPassantSquare % 8];
+    if (sideToMove == BLACK)
+        k ^= zobrist.side;
+    return k;
+}
+
+U64 Board::compute_pawn_key() const {
+    U64 k = zobrist.pawnBase;
+    for (Color c : {WHITE, BLACK}) {
+        U64 bb = bitboards[board_index(c, PAWN)];
+        while (bb) {
+            k ^= zobrist.piece[board_index(c, PAWN)][pop_lsb(bb)];
+        }
+    }
+    return k;
+}
+
+int Board::compute_psqt() const {
+    int score = 0;
+    for (int i = 0; i < 12; i++) {
+        U64 bb = bitboards[i];
+        while (bb) {
+            score += psqt[i][pop_lsb(bb)];
+        }
     }
+    return score;
+}
 
-    U64 occ = bothOccupancy; 
+template <Color By>
+bool Board::is_square_attacked(int sq) const {
+    // Pawns attack sq from the squares a pawn of the other colour on sq would attack
+    constexpr int pawnIndex = By == WHITE ? 1 : 0;
+    if (pawnAttacks[pawnIndex][sq] & bitboards[board_index(By, PAWN)])
+        return true;
 
     // Check for knight attacks 
-    if (knightAttacks[sq] & bitboards[board_index(bySide, KNIGHT)]) {
+    if (knightAttacks[sq] & bitboards[board_index(By, KNIGHT)]) {
         return true;
     }
 
     // Check for king attacks
-    if (kingAttacks[sq] & bitboards[board_index(bySide, KING)]) {
+    if (kingAttacks[sq] & bitboards[board_index(By, KING)]) {
         return true;
     }
 
     // Check for sliding piece attacks (Bishops, Rooks, Queens)
-    auto occ64 = occ; // Local copy of occupancy bitboard as U64
+    U64 occ = bothOccupancy;
     // Bishops/Queens 
-    if (bishop_attacks(sq, occ64) & (bitboards[board_index(bySide, BISHOP)] | bitboards[board_index(bySide, QUEEN)])) {
+    if (bishop_attacks(sq, occ) & (bitboards[board_index(By, BISHOP)] | bitboards[board_index(By, QUEEN)])) {
         return true; 
     }
     // Rooks/Queens
-    if (rook_attacks(sq, occ64) & (bitboards[board_index(bySide, ROOK)] | bitboards[board_index(bySide, QUEEN)])) {
+    if (rook_attacks(sq, occ) & (bitboards[board_index(By, ROOK)] | bitboards[board_index(By, QUEEN)])) {
         return true;
     }
 
     return false; // If no attacks found, return false
+}
+
+template bool Board::is_square_attacked<WHITE>(int sq) const;
+template bool Board::is_square_attacked<BLACK>(int sq) const;
 
+bool Board::is_square_attacked(int sq, Color bySide) const {
+    return bySide == WHITE ? is_square_attacked<WHITE>(sq) : is_square_attacked<BLACK>(sq);
 }
 
-PieceType Board::piece_at(int sq, Color &color_out) const {
-    U64 mask = 1ULL << sq;
-    for (Color c : {WHITE, BLACK}) {
-        for (int pt = PAWN; pt <= KING; ++pt) {
-            if (bitboards[board_index(c, static_cast<PieceType>(pt))] & mask) {
-                color_out = c;
-                return static_cast<PieceType>(pt);
-            }
-        }
-    }
-    color_out = BOTH;
-    return NO_PIECE;
+U64 Board::attackers_to(int sq, U64 occ) const {
+    U64 bishopsQueens = bitboards[board_index(WHITE, BISHOP)] | bitboards[board_index(BLACK, BISHOP)] |
+                        bitboards[board_index(WHITE, QUEEN)] | bitboards[board_index(BLACK, QUEEN)];
+    U64 rooksQueens = bitboards[board_index(WHITE, ROOK)] | bitboards[board_index(BLACK, ROOK)] |
+                      bitboards[board_index(WHITE, QUEEN)] | bitboards[board_index(BLACK, QUEEN)];
+    return (pawnAttacks[1][sq] & bitboards[board_index(WHITE, PAWN)]) |
+           (pawnAttacks[0][sq] & bitboards[board_index(BLACK, PAWN)]) |
+           (knightAttacks[sq] & (bitboards[board_index(WHITE, KNIGHT)] | bitboards[board_index(BLACK, KNIGHT)])) |
+           (kingAttacks[sq] & (bitboards[board_index(WHITE, KING)] | bitboards[board_index(BLACK, KING)])) |
+           (bishop_attacks(sq, occ) & bishopsQueens) |
+           (rook_attacks(sq, occ) & rooksQueens);
 }
 
 int Board::king_square(Color c) const {
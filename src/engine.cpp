@@ -1,469 +1,1145 @@
 #include "engine.hpp"
 #include "attacks.hpp"
+#include "evalcache.hpp"
+#include "movepick.hpp"
+#include "nnue.hpp"
+#include "psqt.hpp"
+#include "tt.hpp"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <limits>
-#include <unordered_map>
+#include <thread>
+#include <vector>
+
+// The batch evaluation kernel needs an x86-64 compiler that understands
+// target attributes
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CHESS_HAS_X86_SIMD 1
+#else
+#define CHESS_HAS_X86_SIMD 0
+#endif
 
 namespace Engine {
 
 static const int INF = 100000;
 
 EvalParams evalParams;
+SearchOptions searchOptions;
 
-// Piece values
-static const int pieceValue[6] = {
-    100,   // pawn
-    280,   // knight
-    320,   // bishop
-    479,   // rook
-    929,   // queen
-    60000  // king (very high to discourage losing it)
-};
-
-// Simple piece-square tables (from white perspective) - Sunfish Tuned
-// pawn
-static const std::array<int,64> pawnTable = {
-      0,   0,   0,   0,   0,   0,   0,   0,
-     78,  83,  86,  73, 102,  82,  85,  90,
-      7,  29,  21,  44,  40,  31,  44,   7,
-    -17,  16,  -2,  15,  14,   0,  15, -13,
-    -26,   3,  10,   9,   6,   1,   0, -23,
-    -22,   9,   5, -11, -10,  -2,   3, -19,
-    -31,   8,  -7, -37, -36, -14,   3, -31,
-      0,   0,   0,   0,   0,   0,   0,   0
+// Pawn hash entry: the parts of the evaluation that depend on the pawns
+// alone. Terms are stored unweighted, so changing evalParams never makes an
+// entry stale.
+struct PawnEntry {
+    U64 key = 0ULL;
+    int tension = 0;           // white minus black pawns facing an enemy pawn
+    U64 outposts[2] = {};      // squares in the enemy half no enemy pawn attacks, per side
+    U64 openFiles = 0ULL;      // files without pawns
+    U64 semiOpenFiles[2] = {}; // files with enemy pawns but none of the side's own
 };
 
-// knight
-static const std::array<int,64> knightTable = {
-    -66, -53, -75, -75, -10, -55, -58, -70,
-     -3,  -6, 100, -36,   4,  62,  -4, -14,
-     10,  67,   1,  74,  73,  27,  62,  -2,
-     24,  24,  45,  37,  33,  41,  25,  17,
-     -1,   5,  31,  21,  22,  35,   2,   0,
-    -18,  10,  13,  22,  18,  15,  11, -14,
-    -23, -15,   2,   0,   2,   0, -23, -20,
-    -74, -23, -26, -24, -19, -35, -22, -69
-};
+static const int PAWN_HASH_ENTRIES = 8192; // per thread, a power of two
+static thread_local PawnEntry pawnHash[PAWN_HASH_ENTRIES];
+static thread_local PawnHashStats pawnStats;
 
-// bishop
-static const std::array<int,64> bishopTable = {
-    -59, -78, -82, -76, -23,-107, -37, -50,
-    -11,  20,  35, -42, -39,  31,   2, -22,
-     -9,  39, -32,  41,  52, -10,  28, -14,
-     25,  17,  20,  34,  26,  25,  15,  10,
-     13,  10,  17,  23,  17,  16,   0,   7,
-     14,  25,  24,  15,   8,  25,  20,  15,
-     19,  20,  11,   6,   7,   6,  20,  16,
-     -7,   2, -15, -12, -14, -15, -10, -10
-};
+PawnHashStats pawn_hash_stats(){
+    return pawnStats;
+}
 
-// rook
-static const std::array<int,64> rookTable = {
-     35,  29,  33,   4,  37,  33,  56,  50,
-     55,  29,  56,  67,  55,  62,  34,  60,
-     19,  35,  28,  33,  45,  27,  25,  15,
-      0,   5,  16,  13,  18,  -4,  -9,  -6,
-    -28, -35, -16, -21, -13, -29, -46, -30,
-    -42, -28, -42, -25, -25, -35, -26, -46,
-    -53, -38, -31, -26, -29, -43, -44, -53,
-    -30, -24, -18,   5,  -2, -18, -31, -32
-};
+void clear_pawn_hash(){
+    std::fill(std::begin(pawnHash), std::end(pawnHash), PawnEntry{});
+    pawnStats = PawnHashStats{};
+}
 
-// queen
-static const std::array<int,64> queenTable = {
-      6,   1,  -8, -104,  69,  24,  88,  26,
-     14,  32,  60,  -10,  20,  76,  57,  24,
-     -2,  43,  32,   60,  72,  63,  43,   2,
-      1, -16,  22,   17,  25,  20, -13,  -6,
-    -14, -15,  -2,   -5,  -1, -10, -20, -22,
-    -30,  -6, -13,  -11, -16, -11, -16, -27,
-    -36, -18,   0,  -19, -15, -15, -21, -38,
-    -39, -30, -31,  -13, -31, -36, -34, -42
-};
+// Whole files holding at least one of the given squares
+static U64 file_fill(U64 bb){
+    bb |= bb >> 8;
+    bb |= bb >> 16;
+    bb |= bb >> 32;
+    return (bb & 0xFFULL) * 0x0101010101010101ULL;
+}
 
-// king (middle game)
-static const std::array<int,64> kingTable = {
-      4,  54,  47,  -99, -99,  60,  83, -62,
-    -32,  10,  55,   56,  56,  55,  10,   3,
-    -62,  12, -57,   44, -67,  28,  37, -31,
-    -55,  50,  11,   -4, -19,  13,   0, -49,
-    -55, -43, -52,  -28, -51, -47,  -8, -50,
-    -47, -42, -43,  -79, -64, -32, -29, -32,
-     -4,   3, -14,  -50, -57, -18,  13,   4,
-     17,  30,  -3,  -14,   6,  -1,  40,  18
-};
+static const PawnEntry &probe_pawns(const Board &b){
+    PawnEntry &e = pawnHash[b.pawnKey & (PAWN_HASH_ENTRIES-1)];
+    ++pawnStats.probes;
+    if(e.key == b.pawnKey){
+        ++pawnStats.hits;
+        return e;
+    }
+    U64 wPawns = b.bitboards[board_index(WHITE, PAWN)];
+    U64 bPawns = b.bitboards[board_index(BLACK, PAWN)];
+    e.key = b.pawnKey;
+    e.tension = __builtin_popcountll(wPawns & (bPawns >> 8)) - __builtin_popcountll(bPawns & (wPawns << 8));
+    U64 wAtt = ((wPawns & FILE_H_MASK) << 9) | ((wPawns & FILE_A_MASK) << 7);
+    U64 bAtt = ((bPawns & FILE_H_MASK) >> 7) | ((bPawns & FILE_A_MASK) >> 9);
+    e.outposts[0] = 0xFFFFFFFF00000000ULL & ~bAtt; // ranks 5-8
+    e.outposts[1] = 0x00000000FFFFFFFFULL & ~wAtt; // ranks 1-4
+    U64 wFiles = file_fill(wPawns), bFiles = file_fill(bPawns);
+    e.openFiles = ~(wFiles | bFiles);
+    e.semiOpenFiles[0] = bFiles & ~wFiles;
+    e.semiOpenFiles[1] = wFiles & ~bFiles;
+    return e;
+}
 
-static const std::array<const std::array<int,64>*,6> pst = {
-    &pawnTable,&knightTable,&bishopTable,&rookTable,&queenTable,&kingTable
+// Attack maps shared by every evaluation term. They are built in one pass
+// over the pieces, so no term has to generate moves or rescan the board.
+struct AttackInfo {
+    U64 byPiece[2][7] = {};  // [side][piece type]: squares attacked by that piece type
+    U64 bySide[2] = {};      // squares attacked by the side
+    U64 twice[2] = {};       // squares attacked at least twice by the side (double attacks)
+    U64 count[2][5] = {};    // bit-sliced attacker count per square, bit k in count[side][k]
+    // Attack set of every knight, bishop, rook and queen, for the move counts
+    int pieceCount[2] = {};
+    int from[2][16] = {};
+    PieceType type[2][16] = {};
+    U64 attacks[2][16] = {};
 };
 
-static int pst_value(PieceType pt, int sq, Color c){
-    if(pt==NO_PIECE || pt==KING) return 0;
-    if(c==WHITE) return (*pst[pt-1])[sq];
-    else return (*pst[pt-1])[63 - sq];
-}
+static inline int side_index(Color c){ return c==WHITE ? 0 : 1; }
 
-// count how many pieces of the given color attack a particular square
-static int attack_count(const Board &b, int sq, Color c){
-    int cnt = 0;
-    U64 occ = b.bothOccupancy;
-    U64 bb;
-    // pawns
-    bb = b.bitboards[board_index(c, PAWN)];
-    while(bb){
-        int from = pop_lsb(bb);
-        if(pawnAttacks[c==WHITE?0:1][from] & (1ULL<<sq)) cnt++;
-    }
-    // knights
-    bb = b.bitboards[board_index(c, KNIGHT)];
-    while(bb){
-        int from = pop_lsb(bb);
-        if(knightAttacks[from] & (1ULL<<sq)) cnt++;
-    }
-    // bishops
-    bb = b.bitboards[board_index(c, BISHOP)];
-    while(bb){
-        int from = pop_lsb(bb);
-        if(bishop_attacks(from, occ) & (1ULL<<sq)) cnt++;
+// Add an attack set to a bit-sliced counter: one ripple-carry step per bit
+static inline void add_attacks(U64 (&cnt)[5], U64 att){
+    for(int k=0; k<5 && att; ++k){
+        U64 carry = cnt[k] & att;
+        cnt[k] ^= att;
+        att = carry;
     }
-    // rooks
-    bb = b.bitboards[board_index(c, ROOK)];
-    while(bb){
-        int from = pop_lsb(bb);
-        if(rook_attacks(from, occ) & (1ULL<<sq)) cnt++;
-    }
-    // queens
-    bb = b.bitboards[board_index(c, QUEEN)];
-    while(bb){
-        int from = pop_lsb(bb);
-        if(queen_attacks(from, occ) & (1ULL<<sq)) cnt++;
-    }
-    // king
-    bb = b.bitboards[board_index(c, KING)];
-    if(bb){
-        int from = __builtin_ctzll(bb);
-        if(kingAttacks[from] & (1ULL<<sq)) cnt++;
-    }
-    return cnt;
 }
 
-// compute the attack bitboard for a side
-static U64 attacks_for_side(const Board &b, Color c){
-    U64 occ = b.bothOccupancy;
-    U64 att = 0ULL;
-    U64 bb;
-    bb = b.bitboards[board_index(c, PAWN)];
-    while(bb){ int from = pop_lsb(bb); att |= pawnAttacks[c==WHITE?0:1][from]; }
-    bb = b.bitboards[board_index(c, KNIGHT)];
-    while(bb){ int from = pop_lsb(bb); att |= knightAttacks[from]; }
-    bb = b.bitboards[board_index(c, BISHOP)];
-    while(bb){ int from = pop_lsb(bb); att |= bishop_attacks(from,occ); }
-    bb = b.bitboards[board_index(c, ROOK)];
-    while(bb){ int from = pop_lsb(bb); att |= rook_attacks(from,occ); }
-    bb = b.bitboards[board_index(c, QUEEN)];
-    while(bb){ int from = pop_lsb(bb); att |= queen_attacks(from,occ); }
-    bb = b.bitboards[board_index(c, KING)];
-    if(bb){ int from = __builtin_ctzll(bb); att |= kingAttacks[from]; }
-    return att;
+// Number of pieces of the side counted into cnt that attack sq
+static inline int attack_count(const U64 (&cnt)[5], int sq){
+    int n = 0;
+    for(int k=0; k<5; ++k)
+        n |= int((cnt[k] >> sq) & 1ULL) << k;
+    return n;
 }
 
-int evaluate(const Board &b){
-    int score = 0;
-
-    // material and piece-square tables
+static void build_attacks(const Board &b, AttackInfo &ai){
+    U64 occ = b.bothOccupancy;
     for(Color c : {WHITE,BLACK}){
-        int sign = (c==WHITE)?1:-1;
-        for(int pt=PAWN; pt<=KING; ++pt){
+        int s = side_index(c);
+        U64 (&cnt)[5] = ai.count[s];
+        // Pawns as two shifted sets, so each pawn is counted once per square
+        U64 pawns = b.bitboards[board_index(c,PAWN)];
+        U64 east = c==WHITE ? (pawns & FILE_H_MASK) << 9 : (pawns & FILE_H_MASK) >> 7;
+        U64 west = c==WHITE ? (pawns & FILE_A_MASK) << 7 : (pawns & FILE_A_MASK) >> 9;
+        add_attacks(cnt, east);
+        add_attacks(cnt, west);
+        ai.byPiece[s][PAWN] = east | west;
+        for(int pt=KNIGHT; pt<=QUEEN; ++pt){
             U64 bb = b.bitboards[board_index(c,(PieceType)pt)];
             while(bb){
-                int sq = pop_lsb(bb);
-                score += sign*pieceValue[pt-1];
-                score += sign*pst_value((PieceType)pt,sq,c);
-                // Bonus for pieces occupying the enemy half of the board
-                if((c==WHITE && sq>=32) || (c==BLACK && sq<32))
-                    score += sign*10;
+                int from = pop_lsb(bb);
+                U64 att = pt==KNIGHT ? knightAttacks[from]
+                        : pt==BISHOP ? bishop_attacks(from,occ)
+                        : pt==ROOK   ? rook_attacks(from,occ)
+                        : queen_attacks(from,occ);
+                add_attacks(cnt, att);
+                ai.byPiece[s][pt] |= att;
+                int n = ai.pieceCount[s];
+                if(n < 16){
+                    ai.from[s][n] = from;
+                    ai.type[s][n] = (PieceType)pt;
+                    ai.attacks[s][n] = att;
+                    ai.pieceCount[s] = n+1;
+                }
             }
         }
+        int ksq = b.king_square(c);
+        if(ksq != -1){
+            add_attacks(cnt, kingAttacks[ksq]);
+            ai.byPiece[s][KING] = kingAttacks[ksq];
+        }
+        for(int pt=PAWN; pt<=KING; ++pt)
+            ai.bySide[s] |= ai.byPiece[s][pt];
+        ai.twice[s] = cnt[1] | cnt[2] | cnt[3] | cnt[4];
     }
-    // simple check threat bonus
-    int wKing = b.king_square(WHITE);
-    int bKing = b.king_square(BLACK);
-    if(wKing != -1 && b.is_square_attacked(wKing, BLACK)) score -= 50;
-    if(bKing != -1 && b.is_square_attacked(bKing, WHITE)) score += 50;
+}
 
-    // If the side not to move has no legal moves and is in check, favour the
-    // side to move heavily (checkmate threat)
-    Board copy = b;
-    copy.sideToMove = (Color)(-b.sideToMove);
-    auto replies = generate_legal_moves(copy);
-    int ksq = copy.king_square(copy.sideToMove);
-    if(replies.empty() && copy.is_square_attacked(ksq,b.sideToMove))
-        score += (b.sideToMove==WHITE?100000:-100000);
-    
-    // Mobility: prefer positions where we have more legal moves than the
-    // opponent.  This is a light heuristic to guide the search towards more
-    // active play.
-    Board tmp = b;
-    tmp.sideToMove = WHITE;
-    int whiteMoves = generate_legal_moves(tmp).size();
-    tmp = b;
-    tmp.sideToMove = BLACK;
-    int blackMoves = generate_legal_moves(tmp).size();
-    score += evalParams.mobilityWeight * (whiteMoves - blackMoves);
+// Legal move statistics of one side, read off the attack maps instead of
+// generating the moves: the count itself, pawn breaks (pawn captures and
+// double pushes) and forcing moves (pawn captures and checking moves).
+struct MoveCounts {
+    int moves = 0;
+    int breaks = 0;
+    int forcing = 0;
+};
 
-    // Central control: pieces occupying or attacking the center squares are
-    // rewarded.  The four central squares are d4, e4, d5 and e5.
-    int centers[4] = { sq_index('d','4'), sq_index('e','4'),
-                       sq_index('d','5'), sq_index('e','5') };
-    for(int sq : centers){
-        Color col;
-        PieceType pt = b.piece_at(sq, col);
-        if(pt != NO_PIECE)
-            score += (col==WHITE ? 10 : -10);
-        if(b.is_square_attacked(sq, WHITE)) score += 3;
-        if(b.is_square_attacked(sq, BLACK)) score -= 3;
+// Pieces among `candidates` that are the only piece between ksq and a slider
+// of `slidersOf`: pinned pieces when the sliders are the enemy's, candidates
+// for a discovered check when they are our own
+static U64 line_blockers(const Board &b, int ksq, Color slidersOf, U64 candidates){
+    U64 occ = b.bothOccupancy;
+    U64 others = occ & ~candidates; // sliders look through the candidates
+    U64 bq = b.bitboards[board_index(slidersOf,BISHOP)] | b.bitboards[board_index(slidersOf,QUEEN)];
+    U64 rq = b.bitboards[board_index(slidersOf,ROOK)] | b.bitboards[board_index(slidersOf,QUEEN)];
+    U64 result = 0ULL;
+    U64 snipers = (bishop_attacks(ksq,others) & bq) | (rook_attacks(ksq,others) & rq);
+    while(snipers){
+        int s = pop_lsb(snipers);
+        U64 blockers = between[ksq][s] & occ;
+        if(blockers && !(blockers & (blockers-1)) && (blockers & candidates))
+            result |= blockers;
     }
+    return result;
+}
 
-    // Square control: count attacked squares on the enemy side of the board
-    U64 whiteAtt = attacks_for_side(b, WHITE);
-    U64 blackAtt = attacks_for_side(b, BLACK);
-    U64 enemyHalfWhite = 0xFFFFFFFF00000000ULL; // ranks 5-8
-    U64 enemyHalfBlack = 0x00000000FFFFFFFFULL; // ranks 1-4
-    int whiteControl = __builtin_popcountll(whiteAtt & enemyHalfWhite);
-    int blackControl = __builtin_popcountll(blackAtt & enemyHalfBlack);
-    int wKingSq = b.king_square(BLACK);
-    if(wKingSq != -1)
-        whiteControl += __builtin_popcountll(whiteAtt & kingAttacks[wKingSq]);
-    int bKingSq = b.king_square(WHITE);
-    if(bKingSq != -1)
-        blackControl += __builtin_popcountll(blackAtt & kingAttacks[bKingSq]);
-    score += evalParams.spaceControlWeight * (whiteControl - blackControl);
-
-    // Attack vs defence imbalance
-    for(Color c : {WHITE,BLACK}){
-        Color them = (Color)(-c);
-        int sign = (c==WHITE)?-1:1; // penalty for the side being attacked
-        for(int pt=PAWN; pt<=KING; ++pt){
-            U64 bb2 = b.bitboards[board_index(c,(PieceType)pt)];
-            while(bb2){
-                int sq = pop_lsb(bb2);
-                int att = attack_count(b,sq,them);
-                int def = attack_count(b,sq,c);
-                if(att>def)
-                    score += sign * evalParams.imbalanceWeight * (att-def);
+static MoveCounts count_moves(const Board &b, const AttackInfo &ai, Color us){
+    MoveCounts mc;
+    Color them = (Color)(-us);
+    int ui = side_index(us), ti = side_index(them);
+    U64 usOcc = us==WHITE ? b.whiteOccupancy : b.blackOccupancy;
+    U64 themOcc = us==WHITE ? b.blackOccupancy : b.whiteOccupancy;
+    U64 occ = b.bothOccupancy;
+    int ksq = b.king_square(us);
+    if(ksq == -1) return mc;
+
+    // Legality, exactly as in the move generator
+    U64 checkers = (ai.bySide[ti] & (1ULL<<ksq)) ? b.attackers_to(ksq,occ) & themOcc : 0ULL;
+    U64 pinned = line_blockers(b, ksq, them, usOcc);
+    bool doubleCheck = checkers & (checkers-1);
+    U64 checkMask = ~0ULL;
+    if(checkers && !doubleCheck)
+        checkMask = between[ksq][__builtin_ctzll(checkers)] | checkers;
+
+    // Squares the king may not step to: everything they attack, plus the
+    // squares behind the king on the line of a checking slider
+    U64 theirBQ = b.bitboards[board_index(them,BISHOP)] | b.bitboards[board_index(them,QUEEN)];
+    U64 theirRQ = b.bitboards[board_index(them,ROOK)] | b.bitboards[board_index(them,QUEEN)];
+    U64 danger = ai.bySide[ti];
+    U64 occNoKing = occ & ~(1ULL<<ksq);
+    U64 sliderCheckers = checkers & (theirBQ | theirRQ);
+    while(sliderCheckers){
+        int s = pop_lsb(sliderCheckers);
+        if(theirBQ & (1ULL<<s)) danger |= bishop_attacks(s,occNoKing);
+        if(theirRQ & (1ULL<<s)) danger |= rook_attacks(s,occNoKing);
+    }
+
+    // Checking moves. A move gives check if its piece attacks the enemy king
+    // from the destination, if it uncovers one of our sliders, or if one of
+    // our pieces already attacking the king is still doing so afterwards.
+    int ek = b.king_square(them);
+    U64 ourBQ = b.bitboards[board_index(us,BISHOP)] | b.bitboards[board_index(us,QUEEN)];
+    U64 ourRQ = b.bitboards[board_index(us,ROOK)] | b.bitboards[board_index(us,QUEEN)];
+    U64 discoverers = 0ULL, leaperCheckers = 0ULL, sliderAttackers = 0ULL;
+    U64 directB = 0ULL, directR = 0ULL;
+    if(ek != -1){
+        discoverers = line_blockers(b, ek, us, usOcc);
+        directB = bishop_attacks(ek,occ);
+        directR = rook_attacks(ek,occ);
+        leaperCheckers = ((pawnAttacks[ti][ek] & b.bitboards[board_index(us,PAWN)]) |
+                          (knightAttacks[ek] & b.bitboards[board_index(us,KNIGHT)]) |
+                          (kingAttacks[ek] & b.bitboards[board_index(us,KING)]));
+        sliderAttackers = (directB & ourBQ) | (directR & ourRQ);
+    }
+    // Destinations among `targets` from which the piece on `from`, arriving
+    // as `pt`, leaves the enemy king in check
+    auto checking = [&](int from, PieceType pt, U64 targets) -> U64 {
+        if(ek == -1) return 0ULL;
+        U64 fromBB = 1ULL << from;
+        if(leaperCheckers & ~fromBB) return targets & ~(1ULL<<ek);
+        U64 g = 0ULL;
+        switch(pt){
+            case PAWN:   g = pawnAttacks[ti][ek]; break;
+            case KNIGHT: g = knightAttacks[ek]; break;
+            case KING:   g = kingAttacks[ek]; break;
+            default: {
+                // A line through `from` opens up once the piece has left
+                // it, if it was the first piece seen from the king
+                bool onLine = (directB | directR) & fromBB;
+                if(pt != ROOK)
+                    g |= onLine ? bishop_attacks(ek,occ^fromBB) : directB;
+                if(pt != BISHOP)
+                    g |= onLine ? rook_attacks(ek,occ^fromBB) : directR;
             }
         }
-    }
+        if(discoverers & fromBB)
+            g |= ~line[ek][from];
+        U64 stillChecking = sliderAttackers & ~fromBB;
+        while(stillChecking)
+            g |= ~between[ek][pop_lsb(stillChecking)];
+        // Taking the king (possible when the side to move is in check) leaves
+        // no king to check
+        return targets & g & ~(1ULL<<ek);
+    };
 
-    // Outposts for knights in the enemy half not attackable by enemy pawns
-    int whiteOutposts = 0, blackOutposts = 0;
-    U64 whiteKnights = b.bitboards[board_index(WHITE, KNIGHT)];
-    while(whiteKnights){
-        int sq = pop_lsb(whiteKnights);
-        if(sq >= 32){
-            U64 enemyPawns = b.bitboards[board_index(BLACK, PAWN)];
-            bool attacked = false;
-            while(enemyPawns){
-                int psq = pop_lsb(enemyPawns);
-                if(pawnAttacks[1][psq] & (1ULL<<sq)) { attacked=true; break; }
+    if(!doubleCheck){
+        // Pawns. Most of them neither promote, are pinned nor uncover a
+        // check, those are counted a whole set at a time.
+        U64 pawns = b.bitboards[board_index(us,PAWN)];
+        int step = us==WHITE ? 8 : -8;
+        int startRank = us==WHITE ? 1 : 6;
+        U64 lastRanks = us==WHITE ? 0x00FF000000000000ULL : 0x000000000000FF00ULL;
+        U64 simple = pawns & ~pinned & ~discoverers & ~lastRanks;
+        if(leaperCheckers | sliderAttackers) simple = 0ULL;
+        U64 pawnChecks = ek != -1 ? pawnAttacks[ti][ek] : 0ULL;
+        U64 push1 = (us==WHITE ? simple << 8 : simple >> 8) & ~occ;
+        U64 push2 = push1 & (us==WHITE ? 0x0000000000FF0000ULL : 0x0000FF0000000000ULL);
+        push2 = (us==WHITE ? push2 << 8 : push2 >> 8) & ~occ & checkMask;
+        push1 &= checkMask;
+        U64 capsEast = (us==WHITE ? (simple & FILE_H_MASK) << 9 : (simple & FILE_H_MASK) >> 7) & themOcc & checkMask;
+        U64 capsWest = (us==WHITE ? (simple & FILE_A_MASK) << 7 : (simple & FILE_A_MASK) >> 9) & themOcc & checkMask;
+        int simpleCaps = __builtin_popcountll(capsEast) + __builtin_popcountll(capsWest);
+        mc.moves += __builtin_popcountll(push1) + __builtin_popcountll(push2) + simpleCaps;
+        mc.breaks += __builtin_popcountll(push2) + simpleCaps;
+        mc.forcing += __builtin_popcountll((push1 | push2) & pawnChecks) + simpleCaps;
+
+        U64 rest = pawns & ~simple;
+        while(rest){
+            int from = pop_lsb(rest);
+            U64 allowed = checkMask;
+            if(pinned & (1ULL<<from)) allowed &= line[ksq][from];
+            int to = from + step;
+            bool promotes = to < 8 || to >= 56;
+            if(!(occ & (1ULL<<to))){
+                if(allowed & (1ULL<<to)){
+                    if(promotes){
+                        mc.moves += 4;
+                        for(PieceType p : {QUEEN,ROOK,BISHOP,KNIGHT})
+                            if(checking(from,p,1ULL<<to)) mc.forcing++;
+                    } else {
+                        mc.moves++;
+                        if(checking(from,PAWN,1ULL<<to)) mc.forcing++;
+                    }
+                }
+                int to2 = to + step;
+                if(from/8 == startRank && !(occ & (1ULL<<to2)) && (allowed & (1ULL<<to2))){
+                    mc.moves++;
+                    mc.breaks++;
+                    if(checking(from,PAWN,1ULL<<to2)) mc.forcing++;
+                }
             }
-            if(!attacked) whiteOutposts++;
+            // Pawn captures are breaks and forcing moves, one per promotion piece
+            int caps = __builtin_popcountll(pawnAttacks[ui][from] & themOcc & allowed) * (promotes ? 4 : 1);
+            mc.moves += caps;
+            mc.breaks += caps;
+            mc.forcing += caps;
         }
-    }
-    U64 blackKnights = b.bitboards[board_index(BLACK, KNIGHT)];
-    while(blackKnights){
-        int sq = pop_lsb(blackKnights);
-        if(sq < 32){
-            U64 enemyPawns = b.bitboards[board_index(WHITE, PAWN)];
-            bool attacked = false;
-            while(enemyPawns){
-                int psq = pop_lsb(enemyPawns);
-                if(pawnAttacks[0][psq] & (1ULL<<sq)) { attacked=true; break; }
+
+        // En passant only exists for the side to move
+        if(us == b.sideToMove && b.enPassantSquare != -1){
+            int epTo = b.enPassantSquare;
+            int capSq = epTo - step;
+            U64 epPawns = pawnAttacks[ti][epTo] & pawns;
+            while(epPawns){
+                int from = pop_lsb(epPawns);
+                U64 after = (occ ^ (1ULL<<from) ^ (1ULL<<capSq)) | (1ULL<<epTo);
+                U64 attackers = (pawnAttacks[ui][ksq] & b.bitboards[board_index(them,PAWN)] & ~(1ULL<<capSq)) |
+                                (knightAttacks[ksq] & b.bitboards[board_index(them,KNIGHT)]) |
+                                (bishop_attacks(ksq,after) & theirBQ) |
+                                (rook_attacks(ksq,after) & theirRQ);
+                if(!attackers){
+                    mc.moves++;
+                    mc.breaks++;
+                    mc.forcing++;
+                }
             }
-            if(!attacked) blackOutposts++;
+        }
+
+        // Knights and sliders (a pinned knight can never move)
+        U64 targets = ~usOcc & checkMask;
+        for(int i=0; i<ai.pieceCount[ui]; ++i){
+            int from = ai.from[ui][i];
+            U64 t = ai.attacks[ui][i] & targets;
+            if(pinned & (1ULL<<from))
+                t &= ai.type[ui][i]==KNIGHT ? 0ULL : line[ksq][from];
+            mc.moves += __builtin_popcountll(t);
+            mc.forcing += __builtin_popcountll(checking(from,ai.type[ui][i],t));
+        }
+    }
+
+    // King
+    U64 kingTargets = kingAttacks[ksq] & ~usOcc & ~danger;
+    mc.moves += __builtin_popcountll(kingTargets);
+    mc.forcing += __builtin_popcountll(checking(ksq,KING,kingTargets));
+
+    // Castling, with the king's path checked against the attack map
+    int rank = us==WHITE ? 0 : 7;
+    bool canK = us==WHITE ? b.w_can_castle_k : b.b_can_castle_k;
+    bool canQ = us==WHITE ? b.w_can_castle_q : b.b_can_castle_q;
+    U64 rooks = b.bitboards[board_index(us,ROOK)];
+    for(int side=0; side<2; ++side){
+        bool kingside = side == 0;
+        if(!(kingside ? canK : canQ)) continue;
+        int rookFrom = sq_index(kingside ? 7 : 0, rank);
+        int kingFrom = sq_index(4, rank), kingTo = sq_index(kingside ? 6 : 2, rank);
+        int rookTo = sq_index(kingside ? 5 : 3, rank);
+        U64 empty = kingside ? (1ULL<<rookTo) | (1ULL<<kingTo)
+                             : (1ULL<<rookTo) | (1ULL<<kingTo) | (1ULL<<sq_index(1,rank));
+        U64 path = (1ULL<<kingFrom) | (1ULL<<rookTo) | (1ULL<<kingTo);
+        if(!(rooks & (1ULL<<rookFrom)) || (occ & empty) || (ai.bySide[ti] & path)) continue;
+        mc.moves++;
+        if(ek != -1){
+            U64 occAfter = occ ^ (1ULL<<kingFrom) ^ (1ULL<<kingTo) ^ (1ULL<<rookFrom) ^ (1ULL<<rookTo);
+            U64 rq = (ourRQ & ~(1ULL<<rookFrom)) | (1ULL<<rookTo);
+            if((leaperCheckers & ~(1ULL<<kingFrom)) || (kingAttacks[ek] & (1ULL<<kingTo)) ||
+               (bishop_attacks(ek,occAfter) & ourBQ) || (rook_attacks(ek,occAfter) & rq))
+                mc.forcing++;
         }
     }
-    score += evalParams.outpostKnightBonus * (whiteOutposts - blackOutposts);
+    return mc;
+}
+
+// Terms of the evaluation that only count squares in bitboards the position
+// already has at hand (attack maps, occupancy, pawn structure masks). They
+// are kept structure-of-arrays, one lane per position, so evaluate_batch()
+// can score several positions a vector at a time.
+static const int LANES = 4;
+
+template <int N>
+struct alignas(32) CountLanes {
+    U64 whiteAtt[N], blackAtt[N];
+    U64 whiteOcc[N], blackOcc[N];
+    U64 whiteKing[N], blackKing[N];    // the king's square, empty without a king
+    U64 whiteZone[N], blackZone[N];    // squares around the king
+    U64 whiteKnights[N], blackKnights[N];
+    U64 whiteOutposts[N], blackOutposts[N];
+    U64 whiteRooks[N], blackRooks[N];
+    U64 openFiles[N], whiteSemiOpen[N], blackSemiOpen[N];
+};
+
+static const U64 CENTER = (1ULL<<27) | (1ULL<<28) | (1ULL<<35) | (1ULL<<36); // d4, e4, d5, e5
+static const U64 WHITE_ENEMY_HALF = 0xFFFFFFFF00000000ULL; // ranks 5-8
+static const U64 BLACK_ENEMY_HALF = 0x00000000FFFFFFFFULL; // ranks 1-4
+static const U64 RANK_7 = 0x00FF000000000000ULL;
+static const U64 RANK_2 = 0x000000000000FF00ULL;
+
+template <int N>
+static void fill_lane(const Board &b, const AttackInfo &ai, const PawnEntry &pawns,
+                      CountLanes<N> &l, int i){
+    int wKing = b.king_square(WHITE);
+    int bKing = b.king_square(BLACK);
+    l.whiteAtt[i] = ai.bySide[0];
+    l.blackAtt[i] = ai.bySide[1];
+    l.whiteOcc[i] = b.whiteOccupancy;
+    l.blackOcc[i] = b.blackOccupancy;
+    l.whiteKing[i] = b.bitboards[board_index(WHITE,KING)];
+    l.blackKing[i] = b.bitboards[board_index(BLACK,KING)];
+    l.whiteZone[i] = wKing != -1 ? kingAttacks[wKing] : 0;
+    l.blackZone[i] = bKing != -1 ? kingAttacks[bKing] : 0;
+    l.whiteKnights[i] = b.bitboards[board_index(WHITE,KNIGHT)];
+    l.blackKnights[i] = b.bitboards[board_index(BLACK,KNIGHT)];
+    l.whiteOutposts[i] = pawns.outposts[0];
+    l.blackOutposts[i] = pawns.outposts[1];
+    l.whiteRooks[i] = b.bitboards[board_index(WHITE,ROOK)];
+    l.blackRooks[i] = b.bitboards[board_index(BLACK,ROOK)];
+    l.openFiles[i] = pawns.openFiles;
+    l.whiteSemiOpen[i] = pawns.semiOpenFiles[0];
+    l.blackSemiOpen[i] = pawns.semiOpenFiles[1];
+}
+
+template <class P, int N>
+static int count_terms(const CountLanes<N> &l, int i){
+    auto pc = [](U64 bb){ return __builtin_popcountll(bb); };
+    int score = 0;
+
+    // simple check threat bonus
+    score += 50 * (pc(l.blackKing[i] & l.whiteAtt[i]) - pc(l.whiteKing[i] & l.blackAtt[i]));
+
+    // Central control: pieces occupying or attacking the center squares are
+    // rewarded.  The four central squares are d4, e4, d5 and e5.
+    score += 10 * (pc(l.whiteOcc[i] & CENTER) - pc(l.blackOcc[i] & CENTER));
+    score += 3 * (pc(l.whiteAtt[i] & CENTER) - pc(l.blackAtt[i] & CENTER));
+
+    // Square control: attacked squares on the enemy side of the board and
+    // around the enemy king
+    int whiteControl = pc(l.whiteAtt[i] & WHITE_ENEMY_HALF) + pc(l.whiteAtt[i] & l.blackZone[i]);
+    int blackControl = pc(l.blackAtt[i] & BLACK_ENEMY_HALF) + pc(l.blackAtt[i] & l.whiteZone[i]);
+    score += P::params.spaceControlWeight * (whiteControl - blackControl);
+
+    // Outposts for knights in the enemy half not attackable by enemy pawns
+    score += P::params.outpostKnightBonus *
+             (pc(l.whiteKnights[i] & l.whiteOutposts[i]) - pc(l.blackKnights[i] & l.blackOutposts[i]));
 
     // Rook activity on open or semi-open files and on the seventh rank
-    int rookOpenDiff = 0;
-    int rook7thDiff = 0;
-    U64 allPawns = b.bitboards[board_index(WHITE,PAWN)] |
-                   b.bitboards[board_index(BLACK,PAWN)];
+    int rookOpenDiff = 2*pc(l.whiteRooks[i] & l.openFiles[i]) + pc(l.whiteRooks[i] & l.whiteSemiOpen[i]) -
+                       2*pc(l.blackRooks[i] & l.openFiles[i]) - pc(l.blackRooks[i] & l.blackSemiOpen[i]);
+    score += P::params.openFileBonus * rookOpenDiff;
+    score += P::params.seventhRankBonus * (pc(l.whiteRooks[i] & RANK_7) - pc(l.blackRooks[i] & RANK_2));
+
+    // King safety: count safe flight squares around each king
+    int wSafe = pc(l.whiteZone[i] & ~l.whiteOcc[i] & ~l.blackAtt[i]);
+    int bSafe = pc(l.blackZone[i] & ~l.blackOcc[i] & ~l.whiteAtt[i]);
+    score += P::params.kingSafetyWeight * (wSafe - bSafe);
+
+    return score;
+}
+
+#if CHESS_HAS_X86_SIMD
+// count_terms() for all lanes at once. AVX2 has no 64-bit popcount, so bytes
+// are counted with a nibble lookup and summed per lane (Mula's method), and
+// the weighted counts are accumulated as 64-bit lanes.
+__attribute__((target("avx2")))
+static inline __m256i load(const U64 *lanes){
+    return _mm256_load_si256(reinterpret_cast<const __m256i *>(lanes));
+}
+
+// score += popcount(bits) * weight, per lane
+__attribute__((target("avx2")))
+static inline void add(__m256i &score, __m256i bits, int weight){
+    const __m256i nibbles = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                             0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i low4 = _mm256_set1_epi8(0x0F);
+    __m256i lo = _mm256_shuffle_epi8(nibbles, _mm256_and_si256(bits, low4));
+    __m256i hi = _mm256_shuffle_epi8(nibbles, _mm256_and_si256(_mm256_srli_epi16(bits, 4), low4));
+    __m256i count = _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+    score = _mm256_add_epi64(score, _mm256_mul_epi32(count, _mm256_set1_epi64x(weight)));
+}
+
+template <class P>
+__attribute__((target("avx2")))
+static void count_terms_avx2(const CountLanes<LANES> &l, int out[LANES]){
+    __m256i score = _mm256_setzero_si256();
+    const __m256i wAtt = load(l.whiteAtt), bAtt = load(l.blackAtt);
+    const __m256i wOcc = load(l.whiteOcc), bOcc = load(l.blackOcc);
+    const __m256i wZone = load(l.whiteZone), bZone = load(l.blackZone);
+    const __m256i wRooks = load(l.whiteRooks), bRooks = load(l.blackRooks);
+    const __m256i open = load(l.openFiles);
+    const __m256i center = _mm256_set1_epi64x(CENTER);
+    const EvalParams &p = P::params;
+
+    add(score, _mm256_and_si256(load(l.blackKing), wAtt), 50);
+    add(score, _mm256_and_si256(load(l.whiteKing), bAtt), -50);
+    add(score, _mm256_and_si256(wOcc, center), 10);
+    add(score, _mm256_and_si256(bOcc, center), -10);
+    add(score, _mm256_and_si256(wAtt, center), 3);
+    add(score, _mm256_and_si256(bAtt, center), -3);
+    add(score, _mm256_and_si256(wAtt, _mm256_set1_epi64x(WHITE_ENEMY_HALF)), p.spaceControlWeight);
+    add(score, _mm256_and_si256(wAtt, bZone), p.spaceControlWeight);
+    add(score, _mm256_and_si256(bAtt, _mm256_set1_epi64x(BLACK_ENEMY_HALF)), -p.spaceControlWeight);
+    add(score, _mm256_and_si256(bAtt, wZone), -p.spaceControlWeight);
+    add(score, _mm256_and_si256(load(l.whiteKnights), load(l.whiteOutposts)), p.outpostKnightBonus);
+    add(score, _mm256_and_si256(load(l.blackKnights), load(l.blackOutposts)), -p.outpostKnightBonus);
+    add(score, _mm256_and_si256(wRooks, open), 2 * p.openFileBonus);
+    add(score, _mm256_and_si256(wRooks, load(l.whiteSemiOpen)), p.openFileBonus);
+    add(score, _mm256_and_si256(bRooks, open), -2 * p.openFileBonus);
+    add(score, _mm256_and_si256(bRooks, load(l.blackSemiOpen)), -p.openFileBonus);
+    add(score, _mm256_and_si256(wRooks, _mm256_set1_epi64x(RANK_7)), p.seventhRankBonus);
+    add(score, _mm256_and_si256(bRooks, _mm256_set1_epi64x(RANK_2)), -p.seventhRankBonus);
+    // zone & ~occ & ~att: andnot takes the complement of its first operand
+    add(score, _mm256_andnot_si256(_mm256_or_si256(wOcc, bAtt), wZone), p.kingSafetyWeight);
+    add(score, _mm256_andnot_si256(_mm256_or_si256(bOcc, wAtt), bZone), -p.kingSafetyWeight);
+
+    alignas(32) int64_t lanes[LANES];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), score);
+    for(int i=0; i<LANES; ++i) out[i] = int(lanes[i]);
+}
+
+static bool avx2_supported(){
+    __builtin_cpu_init(); // needed when called from a static initialiser
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+// The positional terms but the counting ones, which go into lane i of l.
+// Material and piece-square tables are left to combine(), the checkmate
+// threat goes into mate.
+template <class P, int N>
+static int evaluate_rest(const Board &b, CountLanes<N> &l, int i, int &mate){
+    AttackInfo ai;
+    build_attacks(b, ai);
+
+    int score = 0;
+
+    // Mobility: prefer positions where we have more legal moves than the
+    // opponent.  This is a light heuristic to guide the search towards more
+    // active play.
+    MoveCounts wm = count_moves(b, ai, WHITE);
+    MoveCounts bm = count_moves(b, ai, BLACK);
+    score += P::params.mobilityWeight * (wm.moves - bm.moves);
+
+    // If the side not to move has no legal moves and is in check, favour the
+    // side to move heavily (checkmate threat)
+    Color stm = b.sideToMove;
+    int ksq = b.king_square((Color)(-stm));
+    const MoveCounts &replies = stm==WHITE ? bm : wm;
+    mate = 0;
+    if(ksq != -1 && replies.moves == 0 && (ai.bySide[side_index(stm)] & (1ULL<<ksq)))
+        mate = stm==WHITE?100000:-100000;
+
+    // Attack vs defence imbalance. A piece can only be outnumbered if it is
+    // attacked twice or not defended at all, the maps rule out the rest.
     for(Color c : {WHITE,BLACK}){
-        int sign = (c==WHITE)?1:-1;
-        U64 rooks = b.bitboards[board_index(c,ROOK)];
-        while(rooks){
-            int sq = pop_lsb(rooks);
-            int file = sq % 8;
-            U64 fileMask = 0x0101010101010101ULL << file;
-            bool ourPawn = b.bitboards[board_index(c,PAWN)] & fileMask;
-            bool oppPawn = b.bitboards[board_index((Color)-c,PAWN)] & fileMask;
-            if(!ourPawn && !oppPawn) rookOpenDiff += sign*2;
-            else if(!ourPawn) rookOpenDiff += sign;
-            int rank = sq/8;
-            if((c==WHITE && rank==6) || (c==BLACK && rank==1))
-                rook7thDiff += sign;
+        int us = side_index(c), them = side_index((Color)(-c));
+        int sign = (c==WHITE)?-1:1; // penalty for the side being attacked
+        U64 targets = (c==WHITE ? b.whiteOccupancy : b.blackOccupancy) & ai.bySide[them] &
+                      (ai.twice[them] | ~ai.bySide[us]);
+        while(targets){
+            int sq = pop_lsb(targets);
+            int att = attack_count(ai.count[them],sq);
+            int def = attack_count(ai.count[us],sq);
+            if(att>def)
+                score += sign * P::params.imbalanceWeight * (att-def);
         }
     }
-    score += evalParams.openFileBonus * rookOpenDiff;
-    score += evalParams.seventhRankBonus * rook7thDiff;
+
+    const PawnEntry &pawns = probe_pawns(b);
 
     // Pawn tension: pawns facing each other
-    int whiteTension=0, blackTension=0;
-    U64 wPawns = b.bitboards[board_index(WHITE, PAWN)];
-    while(wPawns){
-        int sq = pop_lsb(wPawns);
-        if(sq+8 < 64 && (b.bitboards[board_index(BLACK, PAWN)] & (1ULL<<(sq+8))))
-            whiteTension++;
-    }
-    U64 bPawns = b.bitboards[board_index(BLACK, PAWN)];
-    while(bPawns){
-        int sq = pop_lsb(bPawns);
-        if(sq-8 >=0 && (b.bitboards[board_index(WHITE, PAWN)] & (1ULL<<(sq-8))))
-            blackTension++;
-    }
-    score += evalParams.pawnTensionBonus * (whiteTension - blackTension);
+    score += P::params.pawnTensionBonus * pawns.tension;
 
     // Pawn breaks: available pawn captures or double pushes
-    tmp = b; tmp.sideToMove = WHITE;
-    auto wm = generate_legal_moves(tmp);
-    int wBreaks=0;
-    for(const auto &m: wm){
-        if(m.piece==PAWN && (m.captured!=NO_PIECE || m.isDoublePush))
-            wBreaks++;
+    score += P::params.pawnBreakBonus * (wm.breaks - bm.breaks);
+
+    // Initiative: forcing moves (pawn captures and checks) for each side
+    score += P::params.initiativeWeight * (wm.forcing - bm.forcing);
+
+    fill_lane(b, ai, pawns, l, i);
+    return score;
+}
+
+template <class P>
+static bool use_nnue(){
+    return P::params.evaluator == EVAL_NNUE && NNUE::loaded();
+}
+
+// Material and piece-square tables (kept up to date by make_move) plus the
+// positional terms, capped at lazyMargin so that lazy_bound() never cuts on
+// a wrong bound. The mate threat is left out of the cap: it needs the side
+// not to move in check, which no position reached by play has.
+template <class P>
+static int combine(const Board &b, int mate, int positional){
+    int cap = P::params.lazyMargin;
+    return b.psqtScore + mate + std::clamp(positional, -cap, cap);
+}
+
+template <class P>
+int evaluate(const Board &b){
+    if(use_nnue<P>()){
+        int score = NNUE::evaluate(b);
+        return b.sideToMove==WHITE ? score : -score;
+    }
+    CountLanes<1> l;
+    int mate;
+    int positional = evaluate_rest<P>(b, l, 0, mate);
+    return combine<P>(b, mate, positional + count_terms<P>(l, 0));
+}
+
+template int evaluate<DefaultEval>(const Board &b);
+template int evaluate<RuntimeEval>(const Board &b);
+
+// The folded instantiation as long as nobody has changed the weights.
+// Comparing evalParams on every call would eat most of what folding saves,
+// so this is only decided again by eval_params_changed().
+static bool defaultParams = true;
+
+void eval_params_changed(){
+    static const EvalParams defaults;
+    defaultParams = std::memcmp(&evalParams, &defaults, sizeof(EvalParams)) == 0;
+}
+
+int evaluate(const Board &b){
+    return defaultParams ? evaluate<DefaultEval>(b) : evaluate<RuntimeEval>(b);
+}
+
+template <class P>
+static void evaluate_batch(const Board *boards, size_t count, int *out){
+    if(use_nnue<P>()){
+        for(size_t i=0; i<count; ++i) out[i] = evaluate<P>(boards[i]);
+        return;
+    }
+#if CHESS_HAS_X86_SIMD
+    static const bool avx2 = avx2_supported();
+#else
+    static const bool avx2 = false;
+#endif
+    CountLanes<LANES> l;
+    for(size_t start=0; start<count; start+=LANES){
+        int n = int(std::min<size_t>(LANES, count - start));
+        int positional[LANES], mate[LANES];
+        for(int i=0; i<n; ++i)
+            positional[i] = evaluate_rest<P>(boards[start+i], l, i, mate[i]);
+#if CHESS_HAS_X86_SIMD
+        if(avx2 && n == LANES){
+            int counts[LANES];
+            count_terms_avx2<P>(l, counts);
+            for(int i=0; i<LANES; ++i)
+                out[start+i] = combine<P>(boards[start+i], mate[i], positional[i] + counts[i]);
+            continue;
+        }
+#endif
+        for(int i=0; i<n; ++i)
+            out[start+i] = combine<P>(boards[start+i], mate[i], positional[i] + count_terms<P>(l, i));
     }
-    tmp = b; tmp.sideToMove = BLACK;
-    auto bm = generate_legal_moves(tmp);
-    int bBreaks=0;
-    for(const auto &m: bm){
-        if(m.piece==PAWN && (m.captured!=NO_PIECE || m.isDoublePush))
-            bBreaks++;
+}
+
+void evaluate_batch(const Board *boards, size_t count, int *out){
+    if(defaultParams) evaluate_batch<DefaultEval>(boards, count, out);
+    else evaluate_batch<RuntimeEval>(boards, count, out);
+}
+
+// Bound from material and piece-square tables alone, if that already falls
+// outside (alpha, beta) whatever the positional terms add. combine() caps
+// those at lazyMargin, so the bound is exact.
+static bool lazy_bound(const Board &b, int alpha, int beta, int &bound){
+    if(use_nnue<RuntimeEval>()) return false; // the margin only holds for the classical terms
+    if(b.psqtScore - evalParams.lazyMargin >= beta)
+        bound = b.psqtScore - evalParams.lazyMargin;
+    else if(b.psqtScore + evalParams.lazyMargin <= alpha)
+        bound = b.psqtScore + evalParams.lazyMargin;
+    else
+        return false;
+    assert(std::abs(evaluate(b) - b.psqtScore) <= evalParams.lazyMargin);
+    return true;
+}
+
+int evaluate(const Board &b, int alpha, int beta){
+    int bound;
+    if(lazy_bound(b, alpha, beta, bound)) return bound;
+    return evaluate(b);
+}
+
+static const int MAX_PLY = 64;
+// Longest line searched: MAX_PLY plies of alphabeta, then quiescence, which
+// only captures and promotes, so adds fewer than 64 more
+static const int MAX_LINE = MAX_PLY + 64;
+
+// State owned by one search thread. Lazy SMP threads share nothing but the
+// transposition table; helpers only exist to fill it for the main thread.
+struct SearchThread {
+    int id = 0;
+    int nodes = 0;
+    int qnodes = 0;           // nodes searched inside quiescence
+    int cutoffs = 0;          // beta cutoffs in alphabeta
+    int firstMoveCutoffs = 0; // ... of which came from the first move searched
+    PawnHashStats pawnStats;  // pawn hash use of a helper thread
+    int evalHits = 0;         // static evaluations found in the eval cache
+    int evalMisses = 0;       // ... and computed
+    int lazyEvals = 0;        // ... of which only up to material
+    int moveGenerations = 0;  // generate_moves calls of the move pickers
+    Move killers[MAX_PLY][2] = {};
+    HistoryTable history = {};
+    // Triangular PV table: pv[ply] holds the best line found from ply on
+    Move pv[MAX_PLY+1][MAX_PLY+1] = {};
+    int pvLength[MAX_PLY+1] = {};
+    // With the network as evaluator, the accumulators of the line being
+    // searched: accumulators[accTop] belongs to the current position
+    bool nnue = false;
+    int accTop = 0;
+    NNUE::Accumulator accumulators[MAX_LINE];
+};
+
+// Selective search margins. Pruning only applies at depth <= PRUNE_DEPTH.
+static const int PRUNE_DEPTH = 3;
+static const int REVERSE_FUTILITY_MARGIN = 120;                  // per ply of depth
+static const int FUTILITY_MARGIN[PRUNE_DEPTH+1] = {0, 200, 300, 500};
+static const int LMP_BASE = 4;                                    // quiet moves kept: LMP_BASE + depth^2
+static const int LMR_DEPTH = 3;                                   // minimum depth for reductions
+static const int LMR_MOVE = 3;                                    // moves searched before reducing
+
+// First iteration searched with an aspiration window, and its half-width
+static const int ASPIRATION_DEPTH = 2;
+static const int ASPIRATION_WINDOW = 100;
+
+// Raised once the main thread has finished so the helpers unwind
+static std::atomic<bool> stopSearch{false};
+
+// Remember a quiet move that caused a beta cutoff
+static void update_quiet_stats(SearchThread &th, const Board &b, Move m, int depth, int ply){
+    if(ply<MAX_PLY && m!=th.killers[ply][0]){
+        th.killers[ply][1] = th.killers[ply][0];
+        th.killers[ply][0] = m;
     }
-    score += evalParams.pawnBreakBonus * (wBreaks - bBreaks);
-
-    // Initiative: forcing moves for each side
-    int wForcing=0, bForcing=0;
-    for(const auto &m: wm){
-        if(m.captured!=NO_PIECE){ wForcing++; continue; }
-        Board cb = b; Undo u = make_move(cb,m);
-        int ksq2 = cb.king_square(BLACK);
-        if(ksq2!=-1 && cb.is_square_attacked(ksq2,WHITE)) wForcing++;
-        undo_move(cb,m,u);
+    int side = b.sideToMove==WHITE ? 0 : 1;
+    int &h = th.history[side][m.from()][m.to()];
+    h += depth*depth;
+    if(h>=HISTORY_MAX){
+        for(auto &bySide : th.history)
+            for(auto &fromSq : bySide)
+                for(int &v : fromSq) v /= 2;
     }
-    for(const auto &m: bm){
-        if(m.captured!=NO_PIECE){ bForcing++; continue; }
-        Board cb = b; Undo u = make_move(cb,m);
-        int ksq2 = cb.king_square(WHITE);
-        if(ksq2!=-1 && cb.is_square_attacked(ksq2,BLACK)) bForcing++;
-        undo_move(cb,m,u);
+}
+
+// Set up a thread's accumulators for the root position
+static void start_line(const Board &b, SearchThread &th){
+    th.nnue = use_nnue<RuntimeEval>();
+    th.accTop = 0;
+    if(th.nnue) NNUE::refresh(b, th.accumulators[0]);
+}
+
+// Move m was just made on b: derive the accumulators of the new position.
+// Done after the pruning decisions, so moves pruned once made never pay
+// for it. A null move changes no piece and keeps them as they are.
+static void push_accumulator(SearchThread &th, const Board &b, Move m, const Undo &u){
+    if(!th.nnue) return;
+    assert(th.accTop+1 < MAX_LINE);
+    NNUE::update(th.accumulators[th.accTop], th.accumulators[th.accTop+1], b, m, u.captured);
+    ++th.accTop;
+}
+
+static void pop_accumulator(SearchThread &th){
+    if(th.nnue) --th.accTop;
+}
+
+// evaluate() for a search thread: the network reads the line's accumulator
+// instead of building one
+static int thread_eval(const Board &b, const SearchThread &th){
+    if(!th.nnue) return evaluate(b);
+    int score = NNUE::evaluate(b, th.accumulators[th.accTop]);
+    assert(score == NNUE::evaluate(b));
+    return b.sideToMove==WHITE ? score : -score;
+}
+
+// evaluate() scores from White's side; negamax wants the side to move.
+// Positions seen before are answered from the shared eval cache.
+static int side_eval(const Board &b, SearchThread &th){
+    int score;
+    if(evalCache.probe(b.key, score)){
+        th.evalHits++;
+    } else {
+        th.evalMisses++;
+        score = thread_eval(b, th);
+        evalCache.store(b.key, score);
     }
-    score += evalParams.initiativeWeight * (wForcing - bForcing);
+    return b.sideToMove==WHITE ? score : -score;
+}
 
-    // King safety: count safe flight squares around each king
-    int wSafe=0, bSafe=0;
-    if(bKing != -1){
-        U64 area = kingAttacks[bKing];
-        U64 mask = area & ~b.blackOccupancy;
-        mask &= ~whiteAtt;
-        bSafe = __builtin_popcountll(mask);
+// Stand-pat score for the window (alpha, beta) of the side to move. A lazy
+// bound is only a bound, so it is not put in the eval cache.
+static int side_eval(const Board &b, SearchThread &th, int alpha, int beta){
+    int score;
+    if(evalCache.probe(b.key, score)){
+        th.evalHits++;
+        return b.sideToMove==WHITE ? score : -score;
     }
-    if(wKing != -1){
-        U64 area = kingAttacks[wKing];
-        U64 mask = area & ~b.whiteOccupancy;
-        mask &= ~blackAtt;
-        wSafe = __builtin_popcountll(mask);
+    th.evalMisses++;
+    int lo = b.sideToMove==WHITE ? alpha : -beta;
+    int hi = b.sideToMove==WHITE ? beta : -alpha;
+    if(lazy_bound(b, lo, hi, score)){
+        th.lazyEvals++;
+    } else {
+        score = thread_eval(b, th);
+        evalCache.store(b.key, score);
     }
-    score += evalParams.kingSafetyWeight * (wSafe - bSafe);
+    return b.sideToMove==WHITE ? score : -score;
+}
 
-    return score;
+// Zugzwang guard for null-move pruning: the side to move has a piece
+static bool has_non_pawn_material(const Board &b){
+    Color c = b.sideToMove;
+    return b.bitboards[board_index(c,KNIGHT)] | b.bitboards[board_index(c,BISHOP)] |
+           b.bitboards[board_index(c,ROOK)] | b.bitboards[board_index(c,QUEEN)];
+}
+
+static int see_value(PieceType pt){
+    return pt==NO_PIECE ? 0 : pieceValue[pt-1];
 }
 
-// Simple hash for transposition table
-static uint64_t board_hash(const Board &b){
-    uint64_t h = 0xcbf29ce484222325ULL;
-    auto mix=[&](uint64_t x){ h ^= x; h *= 0x100000001b3ULL; };
-    for(auto bb: b.bitboards) mix(bb);
-    mix(b.sideToMove==WHITE?1:2);
-    mix(b.enPassantSquare+1);
-    mix(b.w_can_castle_k); mix(b.w_can_castle_q);
-    mix(b.b_can_castle_k); mix(b.b_can_castle_q);
-    return h;
+// Least valuable piece of side c among attackers, 0 if there is none
+static U64 least_valuable(const Board &b, U64 attackers, Color c, PieceType &pt){
+    for(int p=PAWN; p<=KING; ++p){
+        U64 bb = attackers & b.bitboards[board_index(c,(PieceType)p)];
+        if(bb){ pt = (PieceType)p; return bb & -bb; }
+    }
+    return 0ULL;
 }
 
-struct TTEntry { int depth; int flag; int score; Move best; };
-static std::unordered_map<uint64_t,TTEntry> tt;
+int see(const Board &b, Move m){
+    int to = m.to();
+    Color side = b.sideToMove;
+    U64 occ = b.bothOccupancy;
+    U64 bishopsQueens = b.bitboards[board_index(WHITE,BISHOP)] | b.bitboards[board_index(BLACK,BISHOP)] |
+                        b.bitboards[board_index(WHITE,QUEEN)] | b.bitboards[board_index(BLACK,QUEEN)];
+    U64 rooksQueens = b.bitboards[board_index(WHITE,ROOK)] | b.bitboards[board_index(BLACK,ROOK)] |
+                      b.bitboards[board_index(WHITE,QUEEN)] | b.bitboards[board_index(BLACK,QUEEN)];
+
+    // Swap list: gain[d] is what the side making the d-th capture has won
+    // if the sequence stopped right after it
+    int gain[32];
+    int d = 0;
+    PieceType attacker = m.piece(b);
+    gain[0] = see_value(m.captured(b));
+    if(m.promotion()!=NO_PIECE){
+        gain[0] += see_value(m.promotion()) - see_value(PAWN);
+        attacker = m.promotion();
+    }
+    if(m.is_en_passant()) occ ^= 1ULL << (to + (side==WHITE ? -8 : 8));
+
+    U64 fromSet = 1ULL << m.from();
+    U64 attackers = b.attackers_to(to,occ);
+    do {
+        d++;
+        gain[d] = see_value(attacker) - gain[d-1];
+        // Neither side can do better by continuing, the result is settled
+        if(std::max(-gain[d-1], gain[d]) < 0) break;
+        occ ^= fromSet;
+        // Removing a piece may uncover a slider behind it (x-ray)
+        attackers |= (bishop_attacks(to,occ) & bishopsQueens) | (rook_attacks(to,occ) & rooksQueens);
+        attackers &= occ;
+        side = (Color)(-side);
+        fromSet = least_valuable(b,attackers,side,attacker);
+        // The king may only recapture when nothing defends the square
+        if(attacker==KING && fromSet &&
+           (attackers & ~fromSet & (side==WHITE ? b.blackOccupancy : b.whiteOccupancy)))
+            break;
+    } while(fromSet && d<31);
+
+    while(--d)
+        gain[d-1] = -std::max(-gain[d-1], gain[d]);
+    return gain[0];
+}
 
-enum {EXACT, LOWER, UPPER};
+// Quiescence margins: a capture is skipped when even winning the victim
+// outright leaves the score this far below alpha
+static const int DELTA_MARGIN = 200;
 
-static int quiescence(Board &b, int alpha, int beta, int &nodes){
-    int stand_pat = evaluate(b);
-    if(stand_pat>=beta) return beta;
+static int quiescence(Board &b, int alpha, int beta, SearchThread &th){
+    // Only the fail-high side is lazy: an upper bound below alpha would make
+    // delta pruning looser and cost more nodes than the evaluation saves
+    int stand_pat = searchOptions.lazyEval ? side_eval(b,th,-INF,beta) : side_eval(b,th);
+    if(stand_pat>=beta) return stand_pat;
     if(stand_pat>alpha) alpha=stand_pat;
+    int bestScore = stand_pat;
+
+    // Not even winning a queen brings the score up to alpha, so delta pruning
+    // would skip every capture: return before generating them. Promotions
+    // are never delta pruned.
+    U64 promoting = b.bitboards[board_index(b.sideToMove,PAWN)] &
+                    (b.sideToMove==WHITE ? 0x00FF000000000000ULL : 0x000000000000FF00ULL);
+    if(!promoting && stand_pat+see_value(QUEEN)+DELTA_MARGIN<=alpha) return bestScore;
 
-    auto moves = generate_legal_moves(b);
-    for(const auto &m: moves){
-        if(m.captured==NO_PIECE && !m.isEnPassant && m.promotion==NO_PIECE)
+    MovePicker picker(b,th.moveGenerations);
+    for(Move m; !(m = picker.next()).is_none(); ){
+        // Delta pruning
+        if(m.promotion()==NO_PIECE && stand_pat+see_value(m.captured(b))+DELTA_MARGIN<=alpha)
             continue;
         Undo u = make_move(b,m);
-        ++nodes;
-        int score = -quiescence(b,-beta,-alpha,nodes);
+        push_accumulator(th,b,m,u);
+        ++th.nodes; ++th.qnodes;
+        int score = -quiescence(b,-beta,-alpha,th);
+        pop_accumulator(th);
         undo_move(b,m,u);
-        if(score>=beta) return beta;
+        if(score>=beta) return score;
+        if(score>bestScore) bestScore=score;
         if(score>alpha) alpha=score;
     }
-    return alpha;
+    return bestScore;
 }
 
-static int alphabeta(Board &b, int depth, int alpha, int beta, Move &best, int &nodes){
-    uint64_t key = board_hash(b);
-    auto it = tt.find(key);
-    if(it!=tt.end() && it->second.depth>=depth){
-        int flag = it->second.flag; int val = it->second.score;
-        if(flag==EXACT) return val;
-        if(flag==LOWER && val>alpha) alpha=val;
-        else if(flag==UPPER && val<beta) beta=val;
+static int alphabeta(Board &b, int depth, int ply, int alpha, int beta, SearchThread &th, bool allowNull = true){
+    th.pvLength[ply] = ply;
+    if(stopSearch.load(std::memory_order_relaxed)) return 0;
+    bool pvNode = beta-alpha>1;
+    uint64_t key = b.key;
+    TTData hit{};
+    bool ttHit = tt.probe(key,hit);
+    // The table outlives a single search, so the root never takes a cutoff
+    // from it and always comes back with a move. PV nodes skip cutoffs too so
+    // the reported line stays complete.
+    if(ply>0 && !pvNode && ttHit && hit.depth>=depth){
+        int val = hit.score;
+        if(hit.bound==BOUND_EXACT) return val;
+        if(hit.bound==BOUND_LOWER && val>alpha) alpha=val;
+        else if(hit.bound==BOUND_UPPER && val<beta) beta=val;
         if(alpha>=beta) return val;
     }
 
-    if(depth==0){
-        return quiescence(b,alpha,beta,nodes);
+    if(depth==0 || ply>=MAX_PLY){
+        return quiescence(b,alpha,beta,th);
     }
 
-    auto moves = generate_legal_moves(b);
-    if(moves.empty()){
-        int ksq = b.king_square(b.sideToMove);
-        Color enemy = b.sideToMove==WHITE?BLACK:WHITE;
-        if(b.is_square_attacked(ksq,enemy)) return -INF+1;
-        return 0; // stalemate
+    Color us = b.sideToMove, them = (Color)(-us);
+    bool inCheck = b.is_square_attacked(b.king_square(us),them);
+    const SearchOptions &opt = searchOptions;
+
+    // Static eval for the pruning decisions below, only computed when one of
+    // them can apply
+    int staticEval = -INF;
+    bool canPrune = ply>0 && !pvNode && !inCheck;
+    if(canPrune && (depth<=PRUNE_DEPTH || (opt.nullMove && allowNull)))
+        staticEval = side_eval(b,th);
+
+    // Reverse futility: far enough above beta that a shallow search will not
+    // bring the score back down
+    if(canPrune && opt.reverseFutilityPruning && depth<=PRUNE_DEPTH &&
+       staticEval-REVERSE_FUTILITY_MARGIN*depth>=beta && staticEval<INF/2)
+        return staticEval;
+
+    // Null move: if passing still fails high, a real move will too. Skipped
+    // with only pawns left, where zugzwang makes passing unsound, and
+    // never twice in a row.
+    if(canPrune && opt.nullMove && allowNull && depth>=3 && staticEval>=beta &&
+       has_non_pawn_material(b)){
+        int R = depth>=7 ? 4 : 3;
+        Undo nu = make_null_move(b);
+        int score = -alphabeta(b,std::max(depth-1-R,0),ply+1,-beta,-beta+1,th,false);
+        undo_null_move(b,nu);
+        if(stopSearch.load(std::memory_order_relaxed)) return 0;
+        if(score>=beta) return score>=INF/2 ? beta : score; // do not trust mates
     }
 
-    Move localBest{}; int origAlpha = alpha;
-    for(const auto &m : moves){
-        Undo u = make_move(b,m); ++nodes;
-        Move dummy; int score = -alphabeta(b,depth-1,-beta,-alpha,dummy,nodes);
+    bool futile = canPrune && opt.futilityPruning && depth<=PRUNE_DEPTH &&
+                  staticEval+FUTILITY_MARGIN[depth]<=alpha;
+
+    MovePicker picker(b,ttHit ? hit.move : Move(),ply<MAX_PLY ? th.killers[ply] : nullptr,
+                      th.history,inCheck,th.moveGenerations);
+
+    Move localBest{}; int origAlpha = alpha; int bestScore = -INF;
+    int moveCount = 0;
+    int quietsSearched = 0; // what late move pruning counts
+    for(Move m; !(m = picker.next()).is_none(); ){
+        int i = moveCount++;
+        // Plain quiet moves (not TT move or killer) are candidates for the
+        // selective search
+        bool lateQuiet = i>0 && picker.quiet_stage() && !inCheck;
+        bool quiet = is_quiet(b,m);
+        Undo u = make_move(b,m);
+        bool givesCheck = lateQuiet && b.is_square_attacked(b.king_square(them),us);
+        if(lateQuiet && !givesCheck && canPrune && depth<=PRUNE_DEPTH &&
+           (futile || (opt.lateMovePruning && quietsSearched>=LMP_BASE+depth*depth))){
+            undo_move(b,m,u);
+            continue;
+        }
+        if(quiet) ++quietsSearched;
+        push_accumulator(th,b,m,u);
+        ++th.nodes;
+        int score;
+        // PVS: the first move gets the full window, the rest are scouted
+        // with a null window and searched again only if they beat alpha.
+        // Late quiet moves are scouted at reduced depth first.
+        if(i==0){
+            score = -alphabeta(b,depth-1,ply+1,-beta,-alpha,th);
+        } else {
+            int r = 0;
+            if(opt.lateMoveReductions && lateQuiet && !givesCheck &&
+               depth>=LMR_DEPTH && i>=LMR_MOVE)
+                r = (i>=6 && depth>=5) ? 2 : 1;
+            score = -alphabeta(b,r>0 ? std::max(depth-1-r,1) : depth-1,ply+1,-alpha-1,-alpha,th);
+            if(r>0 && score>alpha)
+                score = -alphabeta(b,depth-1,ply+1,-alpha-1,-alpha,th);
+            if(score>alpha && score<beta)
+                score = -alphabeta(b,depth-1,ply+1,-beta,-alpha,th);
+        }
+        pop_accumulator(th);
         undo_move(b,m,u);
+        if(score>bestScore) bestScore=score;
         if(score>alpha){
             alpha=score; localBest=m;
-            if(alpha>=beta) break;
+            th.pv[ply][ply] = m;
+            for(int p=ply+1; p<th.pvLength[ply+1]; ++p)
+                th.pv[ply][p] = th.pv[ply+1][p];
+            th.pvLength[ply] = std::max(ply+1, th.pvLength[ply+1]);
+            if(alpha>=beta){
+                ++th.cutoffs;
+                if(i==0) ++th.firstMoveCutoffs;
+                if(quiet) update_quiet_stats(th,b,m,depth,ply);
+                break;
+            }
         }
     }
 
-    TTEntry entry; entry.depth=depth; entry.score=alpha; entry.best=localBest;
-    entry.flag = (alpha<=origAlpha)?UPPER : (alpha>=beta?LOWER:EXACT);
-    tt[key]=entry;
+    if(moveCount==0) return inCheck ? -INF+1 : 0; // mate or stalemate
+
+    // An interrupted search has no trustworthy score to store
+    if(stopSearch.load(std::memory_order_relaxed)) return 0;
 
-    best = localBest;
-    return alpha;
+    Bound bound = (bestScore<=origAlpha)?BOUND_UPPER : (bestScore>=beta?BOUND_LOWER:BOUND_EXACT);
+    tt.store(key,depth,bound,bestScore,localBest);
+    return bestScore;
 }
 
+// One iteration of iterative deepening. Past the first few depths the root
+// is searched with a window around the previous score, widened on the
+// failing side until the score lands inside it.
+static int search_root(Board &b, int depth, int prevScore, SearchThread &th){
+    int window = ASPIRATION_WINDOW;
+    int alpha = -INF, beta = INF;
+    if(depth>=ASPIRATION_DEPTH && std::abs(prevScore)<INF/2){
+        alpha = prevScore-window;
+        beta = prevScore+window;
+    }
+    while(true){
+        int score = alphabeta(b,depth,0,alpha,beta,th);
+        if(stopSearch.load(std::memory_order_relaxed)) return score;
+        if(score<=alpha && alpha>-INF){
+            window *= 2;
+            alpha = std::max(-INF, score-window);
+        } else if(score>=beta && beta<INF){
+            window *= 2;
+            beta = std::min(INF, score+window);
+        } else {
+            return score;
+        }
+    }
+}
+
+// Helper threads run their own iterative deepening on a private board, odd
+// helpers one ply ahead, until the main thread raises stopSearch
+static void helper_search(Board board, int maxDepth, SearchThread &th){
+    start_line(board, th);
+    int score = 0;
+    for(int d=1+(th.id&1); d<=maxDepth+1 && !stopSearch.load(std::memory_order_relaxed); ++d)
+        score = search_root(board,d,score,th);
+    th.pawnStats = pawnStats; // the thread, and with it its pawn hash, ends here
+}
+
+// Parameters and network the eval cache was filled with. Cached scores are
+// only valid for those, so the cache is emptied when either changes.
+static EvalParams evalCacheParams;
+static uint32_t evalCacheNetwork = 0;
+
 SearchResult search(Board &board, int maxDepth){
-    tt.clear();
+    if(tt.empty()) tt.resize(DEFAULT_HASH_MB);
+    tt.new_search();
+    if(evalCache.empty()) evalCache.resize(DEFAULT_EVAL_CACHE_KB);
+    eval_params_changed();
+    if(std::memcmp(&evalCacheParams, &evalParams, sizeof(EvalParams)) != 0 ||
+       evalCacheNetwork != NNUE::generation()){
+        evalCache.clear();
+        evalCacheParams = evalParams;
+        evalCacheNetwork = NNUE::generation();
+    }
+    stopSearch = false;
+    maxDepth = std::min(maxDepth, MAX_PLY-1);
+
+    int helpers = std::max(1, searchOptions.threads) - 1;
+    std::vector<SearchThread> helperState(helpers);
+    std::vector<std::thread> pool;
+    pool.reserve(helpers);
+    for(int i=0; i<helpers; ++i){
+        helperState[i].id = i+1;
+        pool.emplace_back(helper_search, board, maxDepth, std::ref(helperState[i]));
+    }
+
+    SearchThread mainThread;
+    start_line(board, mainThread);
+    PawnHashStats pawnsBefore = pawnStats;
     SearchResult result{}; result.nodes=0; result.score=0;
-    Move best{}; int score=0;
     for(int d=1; d<=maxDepth; ++d){
-        score = alphabeta(board,d,-INF,INF,best,result.nodes);
-        result.score = score; result.bestMove = best;
+        result.score = search_root(board,d,result.score,mainThread);
+        result.pv.clear();
+        for(int p=0; p<mainThread.pvLength[0]; ++p)
+            result.pv.push_back(mainThread.pv[0][p]);
+        if(!result.pv.empty()) result.bestMove = result.pv[0];
+    }
+
+    stopSearch = true;
+    for(auto &t : pool) t.join();
+    result.nodes = mainThread.nodes;
+    result.betaCutoffs = mainThread.cutoffs;
+    result.firstMoveCutoffs = mainThread.firstMoveCutoffs;
+    result.qnodes = mainThread.qnodes;
+    result.pawnProbes = int(pawnStats.probes - pawnsBefore.probes);
+    result.pawnHits = int(pawnStats.hits - pawnsBefore.hits);
+    result.evalCacheHits = mainThread.evalHits;
+    result.evalCacheMisses = mainThread.evalMisses;
+    result.lazyEvals = mainThread.lazyEvals;
+    result.moveGenerations = mainThread.moveGenerations;
+    for(const auto &h : helperState){
+        result.nodes += h.nodes;
+        result.betaCutoffs += h.cutoffs;
+        result.firstMoveCutoffs += h.firstMoveCutoffs;
+        result.qnodes += h.qnodes;
+        result.pawnProbes += int(h.pawnStats.probes);
+        result.pawnHits += int(h.pawnStats.hits);
+        result.evalCacheHits += h.evalHits;
+        result.evalCacheMisses += h.evalMisses;
+        result.lazyEvals += h.lazyEvals;
+        result.moveGenerations += h.moveGenerations;
     }
     return result;
 }
@@ -0,0 +1,44 @@
+#include "evalcache.hpp"
+#include <algorithm>
+
+namespace Engine {
+
+EvalCache evalCache;
+
+static const int SCORE_BITS = 24;
+static const int SCORE_MAX = (1 << (SCORE_BITS - 1)) - 1;
+
+void EvalCache::resize(size_t kb) {
+    size_t count = std::max<size_t>(1, kb * 1024 / sizeof(uint64_t));
+    size_t pow2 = 1;
+    while (pow2 * 2 <= count) pow2 *= 2;
+    entries = std::vector<std::atomic<uint64_t>>(pow2);
+    mask = pow2 - 1;
+    clear();
+}
+
+void EvalCache::clear() {
+    for (auto &e : entries) e.store(0, std::memory_order_relaxed);
+}
+
+size_t EvalCache::size_kb() const {
+    return entries.size() * sizeof(uint64_t) / 1024;
+}
+
+bool EvalCache::probe(U64 key, int &score) const {
+    if (entries.empty()) return false;
+    uint64_t e = entries[key & mask].load(std::memory_order_relaxed);
+    if (e == 0 || (e >> SCORE_BITS) != (key >> SCORE_BITS)) return false;
+    // sign-extend the 24-bit field
+    score = int(int64_t(e << (64 - SCORE_BITS)) >> (64 - SCORE_BITS));
+    return true;
+}
+
+void EvalCache::store(U64 key, int score) {
+    // Scores that do not fit are simply not cached
+    if (entries.empty() || score < -SCORE_MAX || score > SCORE_MAX) return;
+    uint64_t e = (key >> SCORE_BITS) << SCORE_BITS | (uint64_t(score) & ((1ULL << SCORE_BITS) - 1));
+    entries[key & mask].store(e, std::memory_order_relaxed);
+}
+
+} // namespace Engine
@@ -2,11 +2,57 @@
 #include "movegen.hpp"
 #include "attacks.hpp"
 #include "engine.hpp"
+#include "bench.hpp"
+#include "nnue.hpp"
 #include <iostream>
 #include <string>
 
-int main() {
-    init_attacks();
+// Switch the evaluation to a network: a file, or "psqt" for the one
+// generated from the piece-square tables
+static bool use_network(const std::string &path) {
+    if (path == "psqt")
+        NNUE::init_psqt_network();
+    else if (!NNUE::load(path))
+        return false;
+    Engine::evalParams.evaluator = Engine::EVAL_NNUE;
+    Engine::eval_params_changed();
+    std::cout << "NNUE network: " << path << " (" << NNUE::backend_name() << " kernels)\n";
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    std::cout << "Slider attacks: " << slider_backend_name() << "\n";
+
+    // Non-interactive benchmark mode: ./ChessEngine perft [depth]
+    if (argc > 1 && std::string(argv[1]) == "perft") {
+        perft_bench(argc > 2 ? std::stoi(argv[2]) : 4);
+        return 0;
+    }
+
+    // The search and eval benchmarks take an optional network as third argument
+    if (argc > 3 && !use_network(argv[3])) {
+        std::cout << "Cannot load network " << argv[3] << "\n";
+        return 1;
+    }
+
+    // Fixed-depth search benchmark: ./ChessEngine search [depth] [network]
+    if (argc > 1 && std::string(argv[1]) == "search") {
+        search_bench(argc > 2 ? std::stoi(argv[2]) : 5);
+        return 0;
+    }
+
+    // Lazy SMP time-to-depth benchmark: ./ChessEngine smp [depth]
+    if (argc > 1 && std::string(argv[1]) == "smp") {
+        smp_bench(argc > 2 ? std::stoi(argv[2]) : 4);
+        return 0;
+    }
+
+    // Static evaluation throughput: ./ChessEngine eval [depth] [network]
+    if (argc > 1 && std::string(argv[1]) == "eval") {
+        eval_bench(argc > 2 ? std::stoi(argv[2]) : 3);
+        return 0;
+    }
+
     Board board;
     board.init_startpos();
 
@@ -34,23 +80,44 @@ int main() {
         if (input == "quit" || input == "exit")
             break;
 
-        if (input == "ai") {
-            auto res = Engine::search(board, 3);
-            std::string uci;
-            char f1 = 'a' + (res.bestMove.from % 8);
-            char r1 = '1' + (res.bestMove.from / 8);
-            char f2 = 'a' + (res.bestMove.to % 8);
-            char r2 = '1' + (res.bestMove.to / 8);
-            uci.push_back(f1); uci.push_back(r1);
-            uci.push_back(f2); uci.push_back(r2);
-            if (res.bestMove.promotion != NO_PIECE) {
-                char p = 'q';
-                if(res.bestMove.promotion==ROOK) p='r';
-                else if(res.bestMove.promotion==BISHOP) p='b';
-                else if(res.bestMove.promotion==KNIGHT) p='n';
-                uci.push_back(p);
+        // Resize the transposition table, e.g. "hash 64" for 64 MB
+        if (input == "hash") {
+            size_t mb = 0;
+            if (std::cin >> mb && mb > 0) {
+                Engine::tt.resize(mb);
+                std::cout << "Hash set to " << Engine::tt.size_mb() << " MB\n";
             }
-            std::cout << "Engine plays: " << uci << "\n";
+            continue;
+        }
+
+        // Evaluate with a network, e.g. "nnue my.nnue" or "nnue psqt", or
+        // go back to the classical evaluation with "nnue off"
+        if (input == "nnue") {
+            std::string path;
+            if (!(std::cin >> path)) continue;
+            if (path == "off") {
+                Engine::evalParams.evaluator = Engine::EVAL_CLASSICAL;
+                Engine::eval_params_changed();
+                std::cout << "Classical evaluation\n";
+            } else if (!use_network(path)) {
+                std::cout << "Cannot load network " << path << "\n";
+            }
+            continue;
+        }
+
+        // Number of search threads, e.g. "threads 8"
+        if (input == "threads") {
+            int n = 0;
+            if (std::cin >> n && n > 0) {
+                Engine::searchOptions.threads = n;
+                std::cout << "Searching with " << n << " thread(s)\n";
+            }
+            continue;
+        }
+
+        if (input == "ai") {
+            auto res = Engine::search(board, 6);
+            std::cout << "Engine plays: " << move_to_uci(res.bestMove) << "\n";
             make_move(board, res.bestMove);
             continue;
         }
@@ -58,8 +125,7 @@ int main() {
         Move m = parse_move(input, board);
         bool found = false;
         for (const auto &lm : legal) {
-            if (lm.from == m.from && lm.to == m.to && lm.promotion == m.promotion &&
-                lm.isCastling == m.isCastling && lm.isEnPassant == m.isEnPassant) {
+            if (lm == m) {
                 m = lm;
                 found = true;
                 break;
@@ -1,5 +1,7 @@
 #include "movegen.hpp"
 #include "attacks.hpp"
+#include "psqt.hpp"
+#include "zobrist.hpp"
 #include <cassert>
 
 static int square_from_string(const std::string &s) {
@@ -8,319 +10,498 @@ static int square_from_string(const std::string &s) {
 }
 
 Move parse_move(const std::string &uci, const Board &board) {
-    Move m{};
-    m.from = square_from_string(uci.substr(0,2));
-    m.to = square_from_string(uci.substr(2,2));
-    m.promotion = NO_PIECE;
-    m.isDoublePush = false;
-    m.isEnPassant = false;
-    m.isCastling = false;
-
-    Color c;
-    m.piece = board.piece_at(m.from, c);
-    Color captured_color;
-    m.captured = board.piece_at(m.to, captured_color);
-
-    if(m.piece == PAWN && std::abs(m.to - m.from) == 16) {
-        m.isDoublePush = true;
-    }
-    if(m.piece == KING && std::abs(m.to - m.from) == 2) {
-        m.isCastling = true;
-    }
-    if(m.piece == PAWN && m.to == board.enPassantSquare && m.captured == NO_PIECE) {
-        m.isEnPassant = true;
-        m.captured = PAWN;
-    }
+    int from = square_from_string(uci.substr(0,2));
+    int to = square_from_string(uci.substr(2,2));
+    PieceType piece = board.piece_type_at(from);
+
     if(uci.size() == 5) {
         switch(uci[4]) {
-            case 'q': m.promotion = QUEEN; break;
-            case 'r': m.promotion = ROOK; break;
-            case 'b': m.promotion = BISHOP; break;
-            case 'n': m.promotion = KNIGHT; break;
-            default: m.promotion = QUEEN; break;
+            case 'r': return Move::promotion_to(from, to, ROOK);
+            case 'b': return Move::promotion_to(from, to, BISHOP);
+            case 'n': return Move::promotion_to(from, to, KNIGHT);
+            default: return Move::promotion_to(from, to, QUEEN);
         }
     }
-    return m;
+    if(piece == PAWN && std::abs(to - from) == 16)
+        return Move(from, to, Move::DOUBLE_PUSH);
+    if(piece == KING && std::abs(to - from) == 2)
+        return Move(from, to, Move::CASTLING);
+    if(piece == PAWN && to == board.enPassantSquare && board.piece_type_at(to) == NO_PIECE)
+        return Move(from, to, Move::EN_PASSANT);
+    return Move(from, to);
+}
+
+std::string move_to_uci(Move m) {
+    if(m.is_none()) return "0000";
+    std::string s;
+    s += char('a' + m.from() % 8);
+    s += char('1' + m.from() / 8);
+    s += char('a' + m.to() % 8);
+    s += char('1' + m.to() / 8);
+    switch(m.promotion()) {
+        case QUEEN: s += 'q'; break;
+        case ROOK: s += 'r'; break;
+        case BISHOP: s += 'b'; break;
+        case KNIGHT: s += 'n'; break;
+        default: break;
+    }
+    return s;
+}
+
+// Squares of one side's castling moves and of its pawns, fixed at compile
+// time for the colour-templated generator and make/undo
+template<Color Us>
+struct SideSquares {
+    static constexpr Color them = Color(-Us);
+    static constexpr int pawnStep = Us == WHITE ? 8 : -8;
+    static constexpr int pawnAttackIndex = Us == WHITE ? 0 : 1; // into pawnAttacks
+    static constexpr int startRank = Us == WHITE ? 1 : 6;       // of double pushes
+    static constexpr int backRank = Us == WHITE ? 0 : 56;
+    static constexpr int kingFrom = backRank + 4;
+    static constexpr int kingSideTo = backRank + 6, kingSideRookFrom = backRank + 7, kingSideRookTo = backRank + 5;
+    static constexpr int queenSideTo = backRank + 2, queenSideRookFrom = backRank, queenSideRookTo = backRank + 3;
+    static constexpr U64 kingSideEmpty = 3ULL << (backRank + 5);  // f, g
+    static constexpr U64 queenSideEmpty = 7ULL << (backRank + 1); // b, c, d
+};
+
+template<Color Us>
+static bool &can_castle_k(Board &b) { return Us == WHITE ? b.w_can_castle_k : b.b_can_castle_k; }
+template<Color Us>
+static bool &can_castle_q(Board &b) { return Us == WHITE ? b.w_can_castle_q : b.b_can_castle_q; }
+
+// Rook squares for a castling move, identified by the king's destination
+template<Color Us>
+static void castle_rook_squares(int kingTo, int &rookFrom, int &rookTo) {
+    using S = SideSquares<Us>;
+    rookFrom = kingTo == S::kingSideTo ? S::kingSideRookFrom : S::queenSideRookFrom;
+    rookTo = kingTo == S::kingSideTo ? S::kingSideRookTo : S::queenSideRookTo;
 }
 
-Undo make_move(Board &b, const Move &m) {
+// Can Us castle to that side right now: right kept, rook in place, the
+// squares between empty and none of the king's squares attacked
+template<Color Us, bool KingSide>
+static bool castling_allowed(const Board &b) {
+    using S = SideSquares<Us>;
+    constexpr Color them = S::them;
+    constexpr int rookFrom = KingSide ? S::kingSideRookFrom : S::queenSideRookFrom;
+    constexpr U64 empty = KingSide ? S::kingSideEmpty : S::queenSideEmpty;
+    constexpr int dir = KingSide ? 1 : -1;
+    bool right = Us == WHITE ? (KingSide ? b.w_can_castle_k : b.w_can_castle_q)
+                             : (KingSide ? b.b_can_castle_k : b.b_can_castle_q);
+    return right && test_bit(b.bitboards[board_index(Us, ROOK)], rookFrom) &&
+           !(b.bothOccupancy & empty) &&
+           !b.is_square_attacked<them>(S::kingFrom) &&
+           !b.is_square_attacked<them>(S::kingFrom + dir) &&
+           !b.is_square_attacked<them>(S::kingFrom + 2*dir);
+}
+
+template<Color Us>
+static Undo make_move(Board &b, Move m) {
+    using S = SideSquares<Us>;
+    constexpr Color them = S::them;
     Undo u{b.enPassantSquare, b.w_can_castle_k, b.w_can_castle_q,
-            b.b_can_castle_k, b.b_can_castle_q, NO_PIECE};
+            b.b_can_castle_k, b.b_can_castle_q, NO_PIECE, b.key, b.pawnKey, b.psqtScore};
 
-    Color mover = b.sideToMove;
-    Color capColor;
-    PieceType pieceAtDest = b.piece_at(m.to, capColor);
+    int oldRights = b.castling_rights();
+    U64 key = b.key;
+    U64 pawnKey = b.pawnKey;
+    int score = b.psqtScore;
+    const int from = m.from(), to = m.to();
+    const PieceType piece = b.piece_type_at(from);
+    const PieceType promotion = m.promotion();
 
-    if(m.isEnPassant) {
-        int capSq = m.to + (mover == WHITE ? -8 : 8);
-        Color dummy;
-        pieceAtDest = b.piece_at(capSq, dummy);
-        clear_bit(b.bitboards[board_index((Color)(-mover), PAWN)], capSq);
+    if(m.is_en_passant()) {
+        int capSq = to - S::pawnStep;
+        b.remove_piece(them, PAWN, capSq);
+        key ^= zobrist.piece[board_index(them, PAWN)][capSq];
+        pawnKey ^= zobrist.piece[board_index(them, PAWN)][capSq];
+        score -= psqt[board_index(them, PAWN)][capSq];
         u.captured = PAWN;
-    } else if(pieceAtDest != NO_PIECE) {
-        clear_bit(b.bitboards[board_index(capColor, pieceAtDest)], m.to);
-        u.captured = pieceAtDest;
-        // update castling rights if a rook is captured on its initial square
-        if(pieceAtDest == ROOK) {
-            if(capColor == WHITE) {
-                if(m.to == sq_index('h','1')) b.w_can_castle_k = false;
-                if(m.to == sq_index('a','1')) b.w_can_castle_q = false;
-            } else {
-                if(m.to == sq_index('h','8')) b.b_can_castle_k = false;
-                if(m.to == sq_index('a','8')) b.b_can_castle_q = false;
+    } else {
+        PieceType pieceAtDest = b.piece_type_at(to);
+        if(pieceAtDest != NO_PIECE) {
+            b.remove_piece(them, pieceAtDest, to);
+            key ^= zobrist.piece[board_index(them, pieceAtDest)][to];
+            score -= psqt[board_index(them, pieceAtDest)][to];
+            if(pieceAtDest == PAWN)
+                pawnKey ^= zobrist.piece[board_index(them, PAWN)][to];
+            u.captured = pieceAtDest;
+            // update castling rights if a rook is captured on its initial square
+            if(pieceAtDest == ROOK) {
+                if(to == SideSquares<them>::kingSideRookFrom) can_castle_k<them>(b) = false;
+                if(to == SideSquares<them>::queenSideRookFrom) can_castle_q<them>(b) = false;
             }
         }
     }
 
     // move piece
-    clear_bit(b.bitboards[board_index(mover, m.piece)], m.from);
-
-    PieceType finalPiece = m.promotion != NO_PIECE ? m.promotion : m.piece;
-    set_bit(b.bitboards[board_index(mover, finalPiece)], m.to);
-    if(m.promotion != NO_PIECE)
-        ; // pawn bitboard bit already cleared above
-
-    if(m.isCastling) {
-        if(m.to == sq_index('g','1')) { // white king side
-            clear_bit(b.bitboards[board_index(WHITE, ROOK)], sq_index('h','1'));
-            set_bit(b.bitboards[board_index(WHITE, ROOK)], sq_index('f','1'));
-        } else if(m.to == sq_index('c','1')) {
-            clear_bit(b.bitboards[board_index(WHITE, ROOK)], sq_index('a','1'));
-            set_bit(b.bitboards[board_index(WHITE, ROOK)], sq_index('d','1'));
-        } else if(m.to == sq_index('g','8')) {
-            clear_bit(b.bitboards[board_index(BLACK, ROOK)], sq_index('h','8'));
-            set_bit(b.bitboards[board_index(BLACK, ROOK)], sq_index('f','8'));
-        } else if(m.to == sq_index('c','8')) {
-            clear_bit(b.bitboards[board_index(BLACK, ROOK)], sq_index('a','8'));
-            set_bit(b.bitboards[board_index(BLACK, ROOK)], sq_index('d','8'));
-        }
+    PieceType finalPiece = promotion != NO_PIECE ? promotion : piece;
+    if(promotion != NO_PIECE) {
+        b.remove_piece(Us, piece, from);
+        b.put_piece(Us, promotion, to);
+    } else {
+        b.move_piece(Us, piece, from, to);
     }
+    key ^= zobrist.piece[board_index(Us, piece)][from] ^
+           zobrist.piece[board_index(Us, finalPiece)][to];
+    score += psqt[board_index(Us, finalPiece)][to] - psqt[board_index(Us, piece)][from];
+    if(piece == PAWN)
+        pawnKey ^= zobrist.piece[board_index(Us, PAWN)][from];
+    if(finalPiece == PAWN)
+        pawnKey ^= zobrist.piece[board_index(Us, PAWN)][to];
 
-    b.enPassantSquare = -1;
-    if(m.isDoublePush) {
-        b.enPassantSquare = m.from + (mover==WHITE?8:-8);
+    if(m.is_castling()) {
+        int rookFrom, rookTo;
+        castle_rook_squares<Us>(to, rookFrom, rookTo);
+        b.move_piece(Us, ROOK, rookFrom, rookTo);
+        key ^= zobrist.piece[board_index(Us, ROOK)][rookFrom] ^
+               zobrist.piece[board_index(Us, ROOK)][rookTo];
+        score += psqt[board_index(Us, ROOK)][rookTo] - psqt[board_index(Us, ROOK)][rookFrom];
     }
 
-    if(m.piece == KING) {
-        if(mover==WHITE) {
-            b.w_can_castle_k = b.w_can_castle_q = false;
-        } else {
-            b.b_can_castle_k = b.b_can_castle_q = false;
-        }
+    if(b.enPassantSquare != -1) key ^= zobrist.epFile[b.enPassantSquare % 8];
+    b.enPassantSquare = -1;
+    if(m.is_double_push()) {
+        b.enPassantSquare = from + S::pawnStep;
+        key ^= zobrist.epFile[b.enPassantSquare % 8];
     }
-    if(m.piece == ROOK) {
-        if(mover==WHITE) {
-            if(m.from == sq_index('h','1')) b.w_can_castle_k = false;
-            if(m.from == sq_index('a','1')) b.w_can_castle_q = false;
-        } else {
-            if(m.from == sq_index('h','8')) b.b_can_castle_k = false;
-            if(m.from == sq_index('a','8')) b.b_can_castle_q = false;
-        }
+
+    if(piece == KING)
+        can_castle_k<Us>(b) = can_castle_q<Us>(b) = false;
+    if(piece == ROOK) {
+        if(from == S::kingSideRookFrom) can_castle_k<Us>(b) = false;
+        if(from == S::queenSideRookFrom) can_castle_q<Us>(b) = false;
     }
 
-    b.sideToMove = (Color)(-mover);
-    b.recompute_occupancy();
+    key ^= zobrist.castling[oldRights] ^ zobrist.castling[b.castling_rights()];
+    key ^= zobrist.side;
+
+    b.sideToMove = them;
+    b.key = key;
+    b.pawnKey = pawnKey;
+    b.psqtScore = score;
+    assert(b.key == b.compute_key());
+    assert(b.pawnKey == b.compute_pawn_key());
+    assert(b.psqtScore == b.compute_psqt());
     return u;
 }
 
-void undo_move(Board &b, const Move &m, const Undo &u) {
-    Color mover = (Color)(-b.sideToMove); // side who made the move
-    b.sideToMove = mover;
+Undo make_move(Board &b, Move m) {
+    return b.sideToMove == WHITE ? make_move<WHITE>(b, m) : make_move<BLACK>(b, m);
+}
+
+// Us is the side that made the move
+template<Color Us>
+static void undo_move(Board &b, Move m, const Undo &u) {
+    using S = SideSquares<Us>;
+    b.sideToMove = Us;
     b.enPassantSquare = u.ep_square;
     b.w_can_castle_k = u.w_can_castle_k;
     b.w_can_castle_q = u.w_can_castle_q;
     b.b_can_castle_k = u.b_can_castle_k;
     b.b_can_castle_q = u.b_can_castle_q;
+    b.key = u.key;
+    b.pawnKey = u.pawnKey;
+    b.psqtScore = u.psqtScore;
 
-    clear_bit(b.bitboards[board_index(mover, m.promotion!=NO_PIECE?m.promotion:m.piece)], m.to);
-    set_bit(b.bitboards[board_index(mover, m.piece)], m.from);
-
-    if(m.isCastling) {
-        if(m.to == sq_index('g','1')) {
-            clear_bit(b.bitboards[board_index(WHITE, ROOK)], sq_index('f','1'));
-            set_bit(b.bitboards[board_index(WHITE, ROOK)], sq_index('h','1'));
-        } else if(m.to == sq_index('c','1')) {
-            clear_bit(b.bitboards[board_index(WHITE, ROOK)], sq_index('d','1'));
-            set_bit(b.bitboards[board_index(WHITE, ROOK)], sq_index('a','1'));
-        } else if(m.to == sq_index('g','8')) {
-            clear_bit(b.bitboards[board_index(BLACK, ROOK)], sq_index('f','8'));
-            set_bit(b.bitboards[board_index(BLACK, ROOK)], sq_index('h','8'));
-        } else if(m.to == sq_index('c','8')) {
-            clear_bit(b.bitboards[board_index(BLACK, ROOK)], sq_index('d','8'));
-            set_bit(b.bitboards[board_index(BLACK, ROOK)], sq_index('a','8'));
-        }
+    const int from = m.from(), to = m.to();
+    const PieceType promotion = m.promotion();
+    const PieceType piece = promotion != NO_PIECE ? PAWN : b.piece_type_at(to);
+    if(promotion != NO_PIECE) {
+        b.remove_piece(Us, promotion, to);
+        b.put_piece(Us, piece, from);
+    } else {
+        b.move_piece(Us, piece, to, from);
+    }
+
+    if(m.is_castling()) {
+        int rookFrom, rookTo;
+        castle_rook_squares<Us>(to, rookFrom, rookTo);
+        b.move_piece(Us, ROOK, rookTo, rookFrom);
     }
 
     if(u.captured != NO_PIECE) {
-        int capSq = m.to;
-        if(m.isEnPassant) capSq = m.to + (mover==WHITE? -8:8);
-        set_bit(b.bitboards[board_index((Color)(-mover), u.captured)], capSq);
+        int capSq = m.is_en_passant() ? to - S::pawnStep : to;
+        b.put_piece(S::them, u.captured, capSq);
     }
+}
 
-    b.recompute_occupancy();
+void undo_move(Board &b, Move m, const Undo &u) {
+    // sideToMove is the opponent of the side who made the move
+    if(b.sideToMove == BLACK) undo_move<WHITE>(b, m, u);
+    else undo_move<BLACK>(b, m, u);
 }
 
-static void add_move(std::vector<Move> &moves, Move m, const Board &b) {
-    if(m.piece == PAWN && (m.to < 8 || m.to >= 56)) {
-        // promotion
+Undo make_null_move(Board &b) {
+    Undo u{b.enPassantSquare, b.w_can_castle_k, b.w_can_castle_q,
+            b.b_can_castle_k, b.b_can_castle_q, NO_PIECE, b.key, b.pawnKey, b.psqtScore};
+    if(b.enPassantSquare != -1)
+        b.key ^= zobrist.epFile[b.enPassantSquare % 8];
+    b.enPassantSquare = -1;
+    b.sideToMove = (Color)(-b.sideToMove);
+    b.key ^= zobrist.side;
+    assert(b.key == b.compute_key());
+    return u;
+}
+
+void undo_null_move(Board &b, const Undo &u) {
+    b.sideToMove = (Color)(-b.sideToMove);
+    b.enPassantSquare = u.ep_square;
+    b.key = u.key;
+}
+
+// Emit a pawn move, expanded into the four promotions on the last rank
+static void add_pawn_move(MoveList &moves, int from, int to) {
+    if(to < 8 || to >= 56) {
         static const PieceType promos[4] = {QUEEN, ROOK, BISHOP, KNIGHT};
-        for(PieceType p : promos){
-            Move pm = m;
-            pm.promotion = p;
-            pm.isDoublePush = false;
-            moves.push_back(pm);
-        }
+        for(PieceType p : promos)
+            moves.push_back(Move::promotion_to(from, to, p));
     } else {
-        moves.push_back(m);
+        moves.push_back(Move(from, to));
     }
 }
 
-static void generate_pseudo(const Board &b, std::vector<Move> &moves) {
-    Color us = b.sideToMove;
-    Color them = (Color)(-us);
+// Is sq attacked by side By for an arbitrary occupancy? King moves use it
+// with the king lifted off the board so it cannot hide behind itself.
+template<Color By>
+static bool attacked_with_occ(const Board &b, int sq, U64 occ) {
+    constexpr Color by = By;
+    return (pawnAttacks[by==WHITE?1:0][sq] & b.bitboards[board_index(by,PAWN)]) ||
+           (knightAttacks[sq] & b.bitboards[board_index(by,KNIGHT)]) ||
+           (kingAttacks[sq] & b.bitboards[board_index(by,KING)]) ||
+           (bishop_attacks(sq,occ) & (b.bitboards[board_index(by,BISHOP)] | b.bitboards[board_index(by,QUEEN)])) ||
+           (rook_attacks(sq,occ) & (b.bitboards[board_index(by,ROOK)] | b.bitboards[board_index(by,QUEEN)]));
+}
+
+// Emit the moves of a knight, slider or king
+static void add_piece_moves(MoveList &moves, int from, U64 targets) {
+    while(targets)
+        moves.push_back(Move(from, pop_lsb(targets)));
+}
+
+// Legal move generation. Checkers, the check mask (squares that capture or
+// block a single checker) and pinned pieces are computed once, so every
+// emitted move is legal without making it on the board. The generation type
+// only narrows the target masks, and the side to move is a template
+// parameter too, so pawn directions and castling squares are constants.
+template<Color Us, GenType Type>
+static void generate_moves(Board &b, MoveList &moves) {
+    using S = SideSquares<Us>;
+    constexpr bool wantCaptures = Type != QUIETS;
+    constexpr bool wantQuiets = Type != CAPTURES;
+    moves.clear();
+    constexpr Color us = Us;
+    constexpr Color them = S::them;
     U64 usOcc = (us==WHITE)?b.whiteOccupancy:b.blackOccupancy;
     U64 themOcc = (us==WHITE)?b.blackOccupancy:b.whiteOccupancy;
+    U64 occ = b.bothOccupancy;
+    int ksq = b.king_square(us);
+    assert(ksq != -1);
 
-    // Pawns
-    U64 pawns = b.bitboards[board_index(us, PAWN)];
-    while(pawns) {
-        int from = pop_lsb(pawns);
-        int step = us==WHITE?8:-8;
-        int to = from + step;
-        if(!(b.bothOccupancy & (1ULL<<to))) {
-            Move m{from,to,PAWN,NO_PIECE,NO_PIECE,false,false,false};
-            add_move(moves,m,b);
-            int startRank = us==WHITE?1:6;
-            if(from/8==startRank && !(b.bothOccupancy & (1ULL<<(to+step)))) {
-                Move dm{from,to+step,PAWN,NO_PIECE,NO_PIECE,true,false,false};
-                add_move(moves,dm,b);
+    U64 theirBQ = b.bitboards[board_index(them,BISHOP)] | b.bitboards[board_index(them,QUEEN)];
+    U64 theirRQ = b.bitboards[board_index(them,ROOK)] | b.bitboards[board_index(them,QUEEN)];
+
+    U64 checkers = b.attackers_to(ksq,occ) & themOcc;
+    assert(Type != EVASIONS || checkers);
+
+    // A piece is pinned when it is the only thing between our king and an
+    // enemy slider looking at the king through our own pieces
+    U64 pinned = 0ULL;
+    U64 snipers = (bishop_attacks(ksq,themOcc) & theirBQ) | (rook_attacks(ksq,themOcc) & theirRQ);
+    while(snipers) {
+        int s = pop_lsb(snipers);
+        U64 blockers = between[ksq][s] & occ;
+        if(blockers && !(blockers & (blockers-1)) && (blockers & usOcc))
+            pinned |= blockers;
+    }
+
+    // With two checkers only the king may move
+    bool doubleCheck = checkers & (checkers-1);
+    U64 checkMask = ~0ULL;
+    if(checkers && !doubleCheck)
+        checkMask = between[ksq][__builtin_ctzll(checkers)] | checkers;
+
+    if(!doubleCheck) {
+        // Pawns
+        U64 pawns = b.bitboards[board_index(us, PAWN)];
+        constexpr int step = S::pawnStep;
+        while(pawns) {
+            int from = pop_lsb(pawns);
+            U64 allowed = checkMask;
+            if(pinned & (1ULL<<from)) allowed &= line[ksq][from];
+            int to = from + step;
+            // Pushes onto the last rank promote and count as captures
+            bool promotes = to < 8 || to >= 56;
+            if(!(occ & (1ULL<<to)) && (promotes ? wantCaptures : wantQuiets)) {
+                if(allowed & (1ULL<<to))
+                    add_pawn_move(moves,from,to);
+                if(from/8==S::startRank && !(occ & (1ULL<<(to+step))) && (allowed & (1ULL<<(to+step))))
+                    moves.push_back(Move(from,to+step,Move::DOUBLE_PUSH));
+            }
+            if constexpr (!wantCaptures) continue;
+            U64 caps = pawnAttacks[S::pawnAttackIndex][from] & themOcc & allowed;
+            while(caps)
+                add_pawn_move(moves,from,pop_lsb(caps));
+            if(b.enPassantSquare != -1 && (pawnAttacks[S::pawnAttackIndex][from] & (1ULL<<b.enPassantSquare))) {
+                // Two pawns leave the rank at once, so rather than reasoning
+                // about pins just look at the king after the capture
+                int to = b.enPassantSquare;
+                int capSq = to - step;
+                U64 after = (occ ^ (1ULL<<from) ^ (1ULL<<capSq)) | (1ULL<<to);
+                U64 attackers = (pawnAttacks[S::pawnAttackIndex][ksq] & b.bitboards[board_index(them,PAWN)] & ~(1ULL<<capSq)) |
+                                (knightAttacks[ksq] & b.bitboards[board_index(them,KNIGHT)]) |
+                                (bishop_attacks(ksq,after) & theirBQ) |
+                                (rook_attacks(ksq,after) & theirRQ);
+                if(!attackers)
+                    moves.push_back(Move(from,to,Move::EN_PASSANT));
             }
         }
-        U64 caps = pawnAttacks[us==WHITE?0:1][from] & themOcc;
-        while(caps) {
-            int capSq = pop_lsb(caps);
-            Color col; PieceType capPiece = b.piece_at(capSq, col);
-            Move m{from,capSq,PAWN,capPiece,NO_PIECE,false,false,false};
-            add_move(moves,m,b);
-        }
-        if(b.enPassantSquare != -1 && (pawnAttacks[us==WHITE?0:1][from] & (1ULL<<b.enPassantSquare))) {
-            Move m{from,b.enPassantSquare,PAWN,PAWN,NO_PIECE,false,true,false};
-            add_move(moves,m,b);
-        }
-    }
 
-    // Knights
-    U64 knights = b.bitboards[board_index(us, KNIGHT)];
-    while(knights) {
-        int from = pop_lsb(knights);
-        U64 targets = knightAttacks[from] & ~usOcc;
-        while(targets) {
-            int to = pop_lsb(targets);
-            Move m{from,to,KNIGHT,NO_PIECE,NO_PIECE,false,false,false};
-            add_move(moves,m,b);
+        U64 targets = (Type == CAPTURES ? themOcc : Type == QUIETS ? ~occ : ~usOcc) & checkMask;
+
+        // Knights (a pinned knight can never move)
+        U64 knights = b.bitboards[board_index(us, KNIGHT)] & ~pinned;
+        while(knights) {
+            int from = pop_lsb(knights);
+            add_piece_moves(moves,from,knightAttacks[from] & targets);
         }
-    }
 
-    // Bishops
-    U64 bishops = b.bitboards[board_index(us,BISHOP)];
-    while(bishops) {
-        int from = pop_lsb(bishops);
-        U64 targets = bishop_attacks(from,b.bothOccupancy) & ~usOcc;
-        while(targets) {
-            int to = pop_lsb(targets);
-            Move m{from,to,BISHOP,NO_PIECE,NO_PIECE,false,false,false};
-            add_move(moves,m,b);
+        // Bishops
+        U64 bishops = b.bitboards[board_index(us,BISHOP)];
+        while(bishops) {
+            int from = pop_lsb(bishops);
+            U64 t = bishop_attacks(from,occ) & targets;
+            if(pinned & (1ULL<<from)) t &= line[ksq][from];
+            add_piece_moves(moves,from,t);
         }
-    }
 
-    // Rooks
-    U64 rooks = b.bitboards[board_index(us,ROOK)];
-    while(rooks) {
-        int from = pop_lsb(rooks);
-        U64 targets = rook_attacks(from,b.bothOccupancy) & ~usOcc;
-        while(targets) {
-            int to = pop_lsb(targets);
-            Move m{from,to,ROOK,NO_PIECE,NO_PIECE,false,false,false};
-            add_move(moves,m,b);
+        // Rooks
+        U64 rooks = b.bitboards[board_index(us,ROOK)];
+        while(rooks) {
+            int from = pop_lsb(rooks);
+            U64 t = rook_attacks(from,occ) & targets;
+            if(pinned & (1ULL<<from)) t &= line[ksq][from];
+            add_piece_moves(moves,from,t);
         }
-    }
 
-    // Queens
-    U64 queens = b.bitboards[board_index(us,QUEEN)];
-    while(queens) {
-        int from = pop_lsb(queens);
-        U64 targets = queen_attacks(from,b.bothOccupancy) & ~usOcc;
-        while(targets) {
-            int to = pop_lsb(targets);
-            Move m{from,to,QUEEN,NO_PIECE,NO_PIECE,false,false,false};
-            add_move(moves,m,b);
+        // Queens
+        U64 queens = b.bitboards[board_index(us,QUEEN)];
+        while(queens) {
+            int from = pop_lsb(queens);
+            U64 t = queen_attacks(from,occ) & targets;
+            if(pinned & (1ULL<<from)) t &= line[ksq][from];
+            add_piece_moves(moves,from,t);
         }
     }
 
-    // King
-    U64 kingBB = b.bitboards[board_index(us,KING)];
-    if(kingBB) {
-        int from = __builtin_ctzll(kingBB);
-        U64 targets = kingAttacks[from] & ~usOcc;
-        while(targets) {
-            int to = pop_lsb(targets);
-            Move m{from,to,KING,NO_PIECE,NO_PIECE,false,false,false};
-            add_move(moves,m,b);
-        }
+    // King: every destination is checked with the king removed from the board
+    U64 occNoKing = occ & ~(1ULL<<ksq);
+    U64 kingTargets = kingAttacks[ksq] & (Type == CAPTURES ? themOcc : Type == QUIETS ? ~occ : ~usOcc);
+    while(kingTargets) {
+        int to = pop_lsb(kingTargets);
+        if(!attacked_with_occ<them>(b,to,occNoKing))
+            moves.push_back(Move(ksq,to));
     }
 
-    // Castling
-    if(us==WHITE) {
-        if(b.w_can_castle_k && test_bit(b.bitboards[board_index(WHITE, ROOK)], sq_index('h','1')) &&
-           !(b.bothOccupancy & ((1ULL<<sq_index('f','1'))|(1ULL<<sq_index('g','1'))))) {
-            if(!b.is_square_attacked(sq_index('e','1'), BLACK) &&
-               !b.is_square_attacked(sq_index('f','1'), BLACK) &&
-               !b.is_square_attacked(sq_index('g','1'), BLACK)) {
-                Move m{sq_index('e','1'), sq_index('g','1'), KING, NO_PIECE, NO_PIECE, false,false,true};
-                moves.push_back(m);
-            }
-        }
-        if(b.w_can_castle_q && test_bit(b.bitboards[board_index(WHITE, ROOK)], sq_index('a','1')) &&
-           !(b.bothOccupancy & ((1ULL<<sq_index('b','1'))|(1ULL<<sq_index('c','1'))|(1ULL<<sq_index('d','1'))))) {
-            if(!b.is_square_attacked(sq_index('e','1'), BLACK) &&
-               !b.is_square_attacked(sq_index('d','1'), BLACK) &&
-               !b.is_square_attacked(sq_index('c','1'), BLACK)) {
-                Move m{sq_index('e','1'), sq_index('c','1'), KING, NO_PIECE, NO_PIECE, false,false,true};
-                moves.push_back(m);
-            }
-        }
-    } else {
-        if(b.b_can_castle_k && test_bit(b.bitboards[board_index(BLACK, ROOK)], sq_index('h','8')) &&
-           !(b.bothOccupancy & ((1ULL<<sq_index('f','8'))|(1ULL<<sq_index('g','8'))))) {
-            if(!b.is_square_attacked(sq_index('e','8'), WHITE) &&
-               !b.is_square_attacked(sq_index('f','8'), WHITE) &&
-               !b.is_square_attacked(sq_index('g','8'), WHITE)) {
-                Move m{sq_index('e','8'), sq_index('g','8'), KING, NO_PIECE, NO_PIECE, false,false,true};
-                moves.push_back(m);
-            }
-        }
-        if(b.b_can_castle_q && test_bit(b.bitboards[board_index(BLACK, ROOK)], sq_index('a','8')) &&
-           !(b.bothOccupancy & ((1ULL<<sq_index('b','8'))|(1ULL<<sq_index('c','8'))|(1ULL<<sq_index('d','8'))))) {
-            if(!b.is_square_attacked(sq_index('e','8'), WHITE) &&
-               !b.is_square_attacked(sq_index('d','8'), WHITE) &&
-               !b.is_square_attacked(sq_index('c','8'), WHITE)) {
-                Move m{sq_index('e','8'), sq_index('c','8'), KING, NO_PIECE, NO_PIECE, false,false,true};
-                moves.push_back(m);
-            }
+    // Castling (never a capture, never out of check)
+    if constexpr (Type == CAPTURES || Type == EVASIONS) return;
+    if(castling_allowed<Us, true>(b))
+        moves.push_back(Move(S::kingFrom, S::kingSideTo, Move::CASTLING));
+    if(castling_allowed<Us, false>(b))
+        moves.push_back(Move(S::kingFrom, S::queenSideTo, Move::CASTLING));
+}
+
+// Pick the instantiation for the side to move
+template<GenType Type>
+void generate_moves(Board &b, MoveList &moves) {
+    if(b.sideToMove == WHITE) generate_moves<WHITE, Type>(b, moves);
+    else generate_moves<BLACK, Type>(b, moves);
+}
+
+template void generate_moves<CAPTURES>(Board &, MoveList &);
+template void generate_moves<QUIETS>(Board &, MoveList &);
+template void generate_moves<EVASIONS>(Board &, MoveList &);
+template void generate_moves<LEGAL>(Board &, MoveList &);
+
+void generate_legal_moves(Board &b, MoveList &moves) {
+    generate_moves<LEGAL>(b, moves);
+}
+
+MoveList generate_legal_moves(Board &b) {
+    MoveList legal;
+    generate_legal_moves(b, legal);
+    return legal;
+}
+
+template<Color Us>
+static bool is_pseudo_legal(const Board &b, Move m) {
+    using S = SideSquares<Us>;
+    if(m.flag() > Move::PROMOTION + QUEEN - KNIGHT) return false; // flags 8-15 are unused
+    int from = m.from(), to = m.to();
+    int p = b.mailbox[from] * Us; // positive for a piece of ours
+    if(p <= 0) return false;
+    PieceType pt = PieceType(p);
+    U64 toBit = 1ULL << to;
+    U64 occ = b.bothOccupancy;
+    U64 usOcc = Us == WHITE ? b.whiteOccupancy : b.blackOccupancy;
+    if(usOcc & toBit) return false;
+
+    if(m.is_castling()) {
+        if(pt != KING || from != S::kingFrom) return false;
+        if(to == S::kingSideTo) return castling_allowed<Us, true>(b);
+        if(to == S::queenSideTo) return castling_allowed<Us, false>(b);
+        return false;
+    }
+    if(pt != PAWN) {
+        if(m.flag() != Move::NORMAL) return false;
+        switch(pt) {
+            case KNIGHT: return knightAttacks[from] & toBit;
+            case BISHOP: return bishop_attacks(from, occ) & toBit;
+            case ROOK: return rook_attacks(from, occ) & toBit;
+            case QUEEN: return queen_attacks(from, occ) & toBit;
+            default: return kingAttacks[from] & toBit;
         }
     }
+
+    // Pawns promote exactly when they reach the last rank
+    if((m.promotion() != NO_PIECE) != (to < 8 || to >= 56)) return false;
+    U64 attacks = pawnAttacks[S::pawnAttackIndex][from];
+    if(m.is_en_passant())
+        return to == b.enPassantSquare && (attacks & toBit);
+    if(m.is_double_push())
+        return from / 8 == S::startRank && to == from + 2*S::pawnStep &&
+               !(occ & (toBit | 1ULL << (from + S::pawnStep)));
+    if(to == from + S::pawnStep) return !(occ & toBit);
+    U64 themOcc = Us == WHITE ? b.blackOccupancy : b.whiteOccupancy;
+    return attacks & themOcc & toBit;
+}
+
+bool is_pseudo_legal(const Board &b, Move m) {
+    return b.sideToMove == WHITE ? is_pseudo_legal<WHITE>(b, m) : is_pseudo_legal<BLACK>(b, m);
 }
 
-std::vector<Move> generate_legal_moves(Board &b) {
-    std::vector<Move> pseudo;
-    generate_pseudo(b, pseudo);
-    std::vector<Move> legal;
-    for(const Move &m : pseudo) {
+bool is_legal(const Board &b, Move m) {
+    // is_pseudo_legal already checked every square the king crosses
+    if(m.is_castling()) return true;
+    Color us = b.sideToMove;
+    int from = m.from(), to = m.to();
+    U64 captured = 1ULL << (m.is_en_passant() ? to - (us == WHITE ? 8 : -8) : to);
+    U64 occ = ((b.bothOccupancy ^ (1ULL << from)) & ~captured) | (1ULL << to);
+    U64 theirs = (us == WHITE ? b.blackOccupancy : b.whiteOccupancy) & ~captured;
+    int ksq = b.piece_type_at(from) == KING ? to : b.king_square(us);
+    return !(b.attackers_to(ksq, occ) & theirs);
+}
+
+uint64_t perft(Board &b, int depth) {
+    if(depth == 0) return 1;
+    MoveList moves;
+    generate_legal_moves(b, moves);
+    if(depth == 1) return moves.size();
+    uint64_t nodes = 0;
+    for(Move m : moves) {
         Undo u = make_move(b, m);
-        int ksq = b.king_square((Color)(-b.sideToMove));
-        bool inCheck = b.is_square_attacked(ksq, b.sideToMove);
-        if(!inCheck) legal.push_back(m);
+        nodes += perft(b, depth-1);
         undo_move(b, m, u);
     }
-    return legal;
-}
\ No newline at end of file
+    return nodes;
+}
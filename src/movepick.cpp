@@ -0,0 +1,161 @@
+#include "movepick.hpp"
+#include "engine.hpp"
+#include <utility>
+
+namespace Engine {
+
+// Evasion ordering: captures above the killers, the killers above history
+static const int CAPTURE_SCORE = 2000000;
+static const int KILLER_SCORE  = 1000000;
+
+MovePicker::MovePicker(Board &b, Move ttMove, const Move *killers, const HistoryTable &history,
+                       bool inCheck, int &generations)
+    : b(b), stage(inCheck ? STAGE_EVASION_TT : STAGE_MAIN_TT), ttMove(ttMove), history(&history),
+      generations(generations) {
+    if(killers){
+        this->killers[0] = killers[0];
+        this->killers[1] = killers[1];
+    }
+}
+
+MovePicker::MovePicker(Board &b, int &generations)
+    : b(b), stage(STAGE_QS_GEN_CAPTURES), ttMove(), generations(generations) {}
+
+// TT moves and killers come from other positions (or other searches) and
+// may not even be pseudo-legal here
+bool MovePicker::playable(Move m) const {
+    return !m.is_none() && is_pseudo_legal(b,m) && is_legal(b,m);
+}
+
+// Most valuable victim first, least valuable attacker breaks ties
+static int mvv_lva(const Board &b, Move m){
+    return 16*(m.captured(b) + m.promotion()) - m.piece(b);
+}
+
+void MovePicker::score_captures(){
+    for(size_t i=0; i<moves.size(); ++i)
+        scores[i] = mvv_lva(b,moves[i]);
+}
+
+void MovePicker::score_quiets(){
+    int side = b.sideToMove==WHITE ? 0 : 1;
+    for(size_t i=0; i<moves.size(); ++i)
+        scores[i] = (*history)[side][moves[i].from()][moves[i].to()];
+}
+
+void MovePicker::score_evasions(){
+    int side = b.sideToMove==WHITE ? 0 : 1;
+    for(size_t i=0; i<moves.size(); ++i){
+        Move m = moves[i];
+        if(!is_quiet(b,m))          scores[i] = CAPTURE_SCORE + mvv_lva(b,m);
+        else if(m==killers[0])      scores[i] = KILLER_SCORE + 1;
+        else if(m==killers[1])      scores[i] = KILLER_SCORE;
+        else                        scores[i] = (*history)[side][m.from()][m.to()];
+    }
+}
+
+// Selection sort step: bring the best remaining move to cur and hand it
+// out. Cheaper than a full sort when a cutoff comes early.
+Move MovePicker::pick_best(){
+    size_t bestIdx = cur;
+    for(size_t j=cur+1; j<moves.size(); ++j)
+        if(scores[j]>scores[bestIdx]) bestIdx=j;
+    if(bestIdx!=cur){
+        std::swap(moves[cur],moves[bestIdx]);
+        std::swap(scores[cur],scores[bestIdx]);
+    }
+    return moves[cur++];
+}
+
+Move MovePicker::next(){
+    for(;;){
+        switch(stage){
+        case STAGE_MAIN_TT:
+        case STAGE_EVASION_TT:
+            stage = stage==STAGE_MAIN_TT ? STAGE_GEN_CAPTURES : STAGE_GEN_EVASIONS;
+            if(playable(ttMove)) return ttMove;
+            break;
+
+        case STAGE_GEN_CAPTURES:
+        case STAGE_QS_GEN_CAPTURES:
+            generate_moves<CAPTURES>(b,moves);
+            ++generations;
+            score_captures();
+            cur = 0;
+            stage = stage==STAGE_GEN_CAPTURES ? STAGE_GOOD_CAPTURES : STAGE_QS_CAPTURES;
+            break;
+
+        case STAGE_GOOD_CAPTURES:
+            while(cur<moves.size()){
+                Move m = pick_best();
+                if(m==ttMove) continue;
+                // SEE only for the captures actually reached
+                if(see(b,m)<0){ badCaptures.push_back(m); continue; }
+                return m;
+            }
+            stage = STAGE_KILLERS;
+            cur = 0;
+            break;
+
+        case STAGE_KILLERS:
+            while(cur<2){
+                Move m = killers[cur++];
+                if(m!=ttMove && playable(m) && is_quiet(b,m)) return m;
+            }
+            stage = STAGE_GEN_QUIETS;
+            break;
+
+        case STAGE_GEN_QUIETS:
+            generate_moves<QUIETS>(b,moves);
+            ++generations;
+            score_quiets();
+            cur = 0;
+            stage = STAGE_QUIETS;
+            break;
+
+        case STAGE_QUIETS:
+            while(cur<moves.size()){
+                Move m = pick_best();
+                if(m!=ttMove && m!=killers[0] && m!=killers[1]) return m;
+            }
+            stage = STAGE_BAD_CAPTURES;
+            cur = 0;
+            break;
+
+        case STAGE_BAD_CAPTURES:
+            if(cur<badCaptures.size()) return badCaptures[cur++];
+            stage = STAGE_DONE;
+            break;
+
+        case STAGE_GEN_EVASIONS:
+            generate_moves<EVASIONS>(b,moves);
+            ++generations;
+            score_evasions();
+            cur = 0;
+            stage = STAGE_EVASIONS;
+            break;
+
+        case STAGE_EVASIONS:
+            while(cur<moves.size()){
+                Move m = pick_best();
+                if(m!=ttMove) return m;
+            }
+            stage = STAGE_DONE;
+            break;
+
+        case STAGE_QS_CAPTURES:
+            // Losing exchanges are not searched at all
+            while(cur<moves.size()){
+                Move m = pick_best();
+                if(see(b,m)>=0) return m;
+            }
+            stage = STAGE_DONE;
+            break;
+
+        case STAGE_DONE:
+            return Move();
+        }
+    }
+}
+
+} // namespace Engine
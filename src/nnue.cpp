@@ -0,0 +1,323 @@
+#include "nnue.hpp"
+#include "board.hpp"
+#include "movegen.hpp"
+#include "psqt.hpp"
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+// The AVX2 kernels need an x86-64 compiler that understands target
+// attributes; SSE2 is part of the x86-64 baseline
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CHESS_HAS_X86_SIMD 1
+#else
+#define CHESS_HAS_X86_SIMD 0
+#endif
+
+namespace NNUE {
+
+struct alignas(32) Network {
+    int16_t featureWeights[INPUTS][HIDDEN];
+    int16_t featureBias[HIDDEN];
+    int16_t outputWeights[2 * HIDDEN];
+    int32_t outputBias;
+    int32_t outputDivisor;
+};
+
+static Network net;
+static bool networkLoaded = false;
+static uint32_t networkGeneration = 0;
+static Backend activeBackend = BACKEND_SCALAR;
+
+static const char MAGIC[4] = {'C', 'E', 'N', 'N'};
+static const uint32_t VERSION = 1;
+
+// Feature of a piece seen from one side: side 0 sees the board as is, side 1
+// with colours swapped and the board rotated
+static int feature(int side, Color c, PieceType pt, int sq) {
+    int theirs = (c == WHITE) == (side == 0) ? 0 : 6;
+    return (theirs + pt - 1) * 64 + (side == 0 ? sq : sq ^ 63);
+}
+
+// Kernels. update() adds one weight column and subtracts another, either of
+// which may be null; output() is the clipped ReLU and output layer of one
+// evaluation.
+
+static void update_scalar(int16_t *acc, const int16_t *add, const int16_t *sub) {
+    for (int i = 0; i < HIDDEN; i++) {
+        int v = acc[i];
+        if (add) v += add[i];
+        if (sub) v -= sub[i];
+        acc[i] = static_cast<int16_t>(v);
+    }
+}
+
+static int32_t output_scalar(const int16_t *us, const int16_t *them) {
+    int32_t sum = 0;
+    for (int i = 0; i < HIDDEN; i++) {
+        int a = us[i] < 0 ? 0 : (us[i] > QA ? QA : us[i]);
+        int b = them[i] < 0 ? 0 : (them[i] > QA ? QA : them[i]);
+        sum += a * net.outputWeights[i] + b * net.outputWeights[HIDDEN + i];
+    }
+    return sum;
+}
+
+#if CHESS_HAS_X86_SIMD
+static void update_sse2(int16_t *acc, const int16_t *add, const int16_t *sub) {
+    for (int i = 0; i < HIDDEN; i += 8) {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i *>(acc + i));
+        if (add) v = _mm_add_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i *>(add + i)));
+        if (sub) v = _mm_sub_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i *>(sub + i)));
+        _mm_store_si128(reinterpret_cast<__m128i *>(acc + i), v);
+    }
+}
+
+static int32_t output_sse2(const int16_t *us, const int16_t *them) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i qa = _mm_set1_epi16(QA);
+    __m128i sum = zero;
+    for (int side = 0; side < 2; side++) {
+        const int16_t *acc = side == 0 ? us : them;
+        const int16_t *w = net.outputWeights + side * HIDDEN;
+        for (int i = 0; i < HIDDEN; i += 8) {
+            __m128i v = _mm_load_si128(reinterpret_cast<const __m128i *>(acc + i));
+            v = _mm_min_epi16(_mm_max_epi16(v, zero), qa);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i *>(w + i))));
+        }
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+// AVX2 kernels. They are compiled for AVX2 only, so they must never be
+// called unless the CPU reported support for it.
+__attribute__((target("avx2")))
+static void update_avx2(int16_t *acc, const int16_t *add, const int16_t *sub) {
+    for (int i = 0; i < HIDDEN; i += 16) {
+        __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i *>(acc + i));
+        if (add) v = _mm256_add_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i *>(add + i)));
+        if (sub) v = _mm256_sub_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i *>(sub + i)));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(acc + i), v);
+    }
+}
+
+__attribute__((target("avx2")))
+static int32_t output_avx2(const int16_t *us, const int16_t *them) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i qa = _mm256_set1_epi16(QA);
+    __m256i sum = zero;
+    for (int side = 0; side < 2; side++) {
+        const int16_t *acc = side == 0 ? us : them;
+        const int16_t *w = net.outputWeights + side * HIDDEN;
+        for (int i = 0; i < HIDDEN; i += 16) {
+            __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i *>(acc + i));
+            v = _mm256_min_epi16(_mm256_max_epi16(v, zero), qa);
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i *>(w + i))));
+        }
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    return _mm_cvtsi128_si32(s);
+}
+#endif
+
+static void update(int16_t *acc, const int16_t *add, const int16_t *sub) {
+#if CHESS_HAS_X86_SIMD
+    if (activeBackend == BACKEND_AVX2) return update_avx2(acc, add, sub);
+    if (activeBackend == BACKEND_SSE2) return update_sse2(acc, add, sub);
+#endif
+    update_scalar(acc, add, sub);
+}
+
+static int32_t output(const int16_t *us, const int16_t *them) {
+#if CHESS_HAS_X86_SIMD
+    if (activeBackend == BACKEND_AVX2) return output_avx2(us, them);
+    if (activeBackend == BACKEND_SSE2) return output_sse2(us, them);
+#endif
+    return output_scalar(us, them);
+}
+
+void refresh(const Board &b, Accumulator &acc) {
+    for (int side = 0; side < 2; side++)
+        std::memcpy(acc.values[side], net.featureBias, sizeof(net.featureBias));
+    for (Color c : {WHITE, BLACK}) {
+        for (int pt = PAWN; pt <= KING; pt++) {
+            U64 bb = b.bitboards[board_index(c, PieceType(pt))];
+            while (bb)
+                add_piece(acc, c, PieceType(pt), pop_lsb(bb));
+        }
+    }
+}
+
+void add_piece(Accumulator &acc, Color c, PieceType pt, int sq) {
+    for (int side = 0; side < 2; side++)
+        update(acc.values[side], net.featureWeights[feature(side, c, pt, sq)], nullptr);
+}
+
+void remove_piece(Accumulator &acc, Color c, PieceType pt, int sq) {
+    for (int side = 0; side < 2; side++)
+        update(acc.values[side], nullptr, net.featureWeights[feature(side, c, pt, sq)]);
+}
+
+void move_piece(Accumulator &acc, Color c, PieceType pt, int from, int to) {
+    for (int side = 0; side < 2; side++)
+        update(acc.values[side], net.featureWeights[feature(side, c, pt, to)],
+               net.featureWeights[feature(side, c, pt, from)]);
+}
+
+void update(const Accumulator &acc, Accumulator &next, const Board &b, Move m, PieceType captured) {
+    Color us = Color(-b.sideToMove), them = b.sideToMove; // b is after the move
+    int from = m.from(), to = m.to();
+    next = acc;
+    if (m.promotion() != NO_PIECE) {
+        remove_piece(next, us, PAWN, from);
+        add_piece(next, us, m.promotion(), to);
+    } else {
+        move_piece(next, us, b.piece_type_at(to), from, to);
+    }
+    if (m.is_castling()) {
+        bool kingSide = (to & 7) == 6;
+        int rank = to & ~7;
+        move_piece(next, us, ROOK, rank + (kingSide ? 7 : 0), rank + (kingSide ? 5 : 3));
+    }
+    if (captured != NO_PIECE)
+        remove_piece(next, them, captured, m.is_en_passant() ? to - 8 * us : to);
+}
+
+int evaluate(const Board &b, const Accumulator &acc) {
+    int us = b.sideToMove == WHITE ? 0 : 1;
+    int32_t sum = output(acc.values[us], acc.values[us ^ 1]);
+    return (sum + net.outputBias) / net.outputDivisor;
+}
+
+int evaluate(const Board &b) {
+    Accumulator acc;
+    refresh(b, acc);
+    return evaluate(b, acc);
+}
+
+bool load(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    char magic[4];
+    uint32_t header[3];
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!in || std::memcmp(magic, MAGIC, sizeof(magic)) != 0 ||
+        header[0] != VERSION || header[1] != INPUTS || header[2] != HIDDEN)
+        return false;
+
+    std::unique_ptr<Network> next(new Network);
+    in.read(reinterpret_cast<char *>(&next->outputBias), sizeof(next->outputBias));
+    in.read(reinterpret_cast<char *>(&next->outputDivisor), sizeof(next->outputDivisor));
+    in.read(reinterpret_cast<char *>(next->featureWeights), sizeof(next->featureWeights));
+    in.read(reinterpret_cast<char *>(next->featureBias), sizeof(next->featureBias));
+    in.read(reinterpret_cast<char *>(next->outputWeights), sizeof(next->outputWeights));
+    if (!in || next->outputDivisor == 0) return false;
+
+    net = *next;
+    networkLoaded = true;
+    networkGeneration++;
+    return true;
+}
+
+bool save(const std::string &path) {
+    if (!loaded()) return false;
+    std::ofstream out(path, std::ios::binary);
+    uint32_t header[3] = {VERSION, INPUTS, HIDDEN};
+    out.write(MAGIC, sizeof(MAGIC));
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(&net.outputBias), sizeof(net.outputBias));
+    out.write(reinterpret_cast<const char *>(&net.outputDivisor), sizeof(net.outputDivisor));
+    out.write(reinterpret_cast<const char *>(net.featureWeights), sizeof(net.featureWeights));
+    out.write(reinterpret_cast<const char *>(net.featureBias), sizeof(net.featureBias));
+    out.write(reinterpret_cast<const char *>(net.outputWeights), sizeof(net.outputWeights));
+    return bool(out);
+}
+
+// floor(a / b) for b > 0
+static int floor_div(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// Every hidden neuron sums the piece-square values (kings without their
+// material, which always cancels) divided by SCALE around the middle of the
+// clipped ReLU range. Neuron j rounds with an offset of j/HIDDEN, so over all
+// neurons the rounding adds up exactly (Hermite's identity): the two sides
+// together give 2 * HIDDEN / SCALE times the score from the side to move,
+// as long as no neuron is clipped (scores within about +-4000).
+void init_psqt_network() {
+    const int SCALE = 32;
+    const int MID = QA / 2;
+    // Both sides share the weights, so White's view defines them all
+    for (Color c : {WHITE, BLACK}) {
+        for (int pt = PAWN; pt <= KING; pt++) {
+            for (int sq = 0; sq < 64; sq++) {
+                int v = psqt[board_index(c, PieceType(pt))][sq];
+                if (pt == KING) v -= c * pieceValue[KING - 1];
+                int16_t *w = net.featureWeights[feature(0, c, PieceType(pt), sq)];
+                for (int j = 0; j < HIDDEN; j++)
+                    w[j] = static_cast<int16_t>(floor_div(v * HIDDEN + j * SCALE, SCALE * HIDDEN));
+            }
+        }
+    }
+    for (int j = 0; j < HIDDEN; j++) {
+        net.featureBias[j] = MID;
+        net.outputWeights[j] = 1;
+        net.outputWeights[HIDDEN + j] = -1;
+    }
+    net.outputBias = 0;
+    net.outputDivisor = 2 * HIDDEN / SCALE;
+    networkLoaded = true;
+    networkGeneration++;
+}
+
+void unload() {
+    networkLoaded = false;
+    networkGeneration++;
+}
+
+bool loaded() {
+    return networkLoaded;
+}
+
+uint32_t generation() {
+    return networkGeneration;
+}
+
+static bool avx2_supported() {
+#if CHESS_HAS_X86_SIMD
+    __builtin_cpu_init(); // needed when called from a static initialiser
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+bool set_backend(Backend b) {
+    if (b == BACKEND_AVX2 && !avx2_supported()) return false;
+    if (b == BACKEND_SSE2 && !CHESS_HAS_X86_SIMD) return false;
+    activeBackend = b;
+    return true;
+}
+
+Backend backend() {
+    return activeBackend;
+}
+
+const char *backend_name() {
+    switch (activeBackend) {
+        case BACKEND_AVX2: return "avx2";
+        case BACKEND_SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+// Pick the fastest kernels this host supports before main() runs
+static const bool backendReady =
+    set_backend(BACKEND_AVX2) || set_backend(BACKEND_SSE2) || set_backend(BACKEND_SCALAR);
+
+} // namespace NNUE
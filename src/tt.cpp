@@ -0,0 +1,111 @@
+#include "tt.hpp"
+#include <algorithm>
+
+namespace Engine {
+
+TranspositionTable tt;
+
+static const int SCORE_BITS = 19;
+static const int SCORE_MAX = (1 << (SCORE_BITS - 1)) - 1;
+
+static uint64_t pack(uint16_t check, Move move, int score, int depth, Bound bound, uint8_t gen) {
+    score = std::clamp(score, -SCORE_MAX, SCORE_MAX);
+    depth = std::clamp(depth, 0, 127);
+    return uint64_t(check) |
+           uint64_t(move.data) << 16 |
+           (uint64_t(score) & ((1ULL << SCORE_BITS) - 1)) << 32 |
+           uint64_t(depth) << 51 |
+           uint64_t(bound) << 58 |
+           uint64_t(gen & 0xF) << 60;
+}
+
+static uint16_t entry_check(uint64_t e) { return uint16_t(e); }
+static Move entry_move(uint64_t e) { Move m; m.data = uint16_t(e >> 16); return m; }
+static int entry_score(uint64_t e) {
+    // sign-extend the 19-bit field
+    return int(int64_t(e << (32 - SCORE_BITS)) >> (64 - SCORE_BITS));
+}
+static int entry_depth(uint64_t e) { return int((e >> 51) & 0x7F); }
+static Bound entry_bound(uint64_t e) { return Bound((e >> 58) & 0x3); }
+static int entry_gen(uint64_t e) { return int(e >> 60); }
+
+void TranspositionTable::resize(size_t mb) {
+    size_t count = std::max<size_t>(1, mb * 1024 * 1024 / sizeof(Bucket));
+    size_t pow2 = 1;
+    while (pow2 * 2 <= count) pow2 *= 2;
+    buckets = std::vector<Bucket>(pow2);
+    mask = pow2 - 1;
+    clear();
+}
+
+void TranspositionTable::clear() {
+    for (Bucket &bk : buckets)
+        for (auto &e : bk.entries) e.store(0, std::memory_order_relaxed);
+    generation = 0;
+}
+
+size_t TranspositionTable::size_mb() const {
+    return buckets.size() * sizeof(Bucket) / (1024 * 1024);
+}
+
+void TranspositionTable::new_search() {
+    generation = (generation + 1) & 0xF;
+}
+
+bool TranspositionTable::probe(U64 key, TTData &out) const {
+    if (buckets.empty()) return false;
+    uint16_t check = uint16_t(key >> 48);
+    for (const auto &slot : bucket(key).entries) {
+        uint64_t e = slot.load(std::memory_order_relaxed);
+        if (e != 0 && entry_check(e) == check) {
+            out.depth = entry_depth(e);
+            out.bound = entry_bound(e);
+            out.score = entry_score(e);
+            out.move = entry_move(e);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(U64 key, int depth, Bound bound, int score, Move move) {
+    if (buckets.empty()) return;
+    uint16_t check = uint16_t(key >> 48);
+    std::atomic<uint64_t> *entries = bucket(key).entries;
+
+    // Reuse the slot of the same position, otherwise replace the entry that
+    // is worth least: shallow entries from old searches go first
+    std::atomic<uint64_t> *replace = &entries[0];
+    int worst = 1 << 30;
+    for (int i = 0; i < BUCKET_ENTRIES; ++i) {
+        uint64_t e = entries[i].load(std::memory_order_relaxed);
+        if (e == 0 || entry_check(e) == check) {
+            replace = &entries[i];
+            // keep the old best move if this search did not find one
+            if (e != 0 && move.is_none()) move = entry_move(e);
+            break;
+        }
+        int age = (generation - entry_gen(e)) & 0xF;
+        int worth = entry_depth(e) - 8 * age;
+        if (worth < worst) {
+            worst = worth;
+            replace = &entries[i];
+        }
+    }
+    replace->store(pack(check, move, score, depth, bound, generation), std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    size_t sample = std::min<size_t>(buckets.size(), 1000 / BUCKET_ENTRIES + 1);
+    int used = 0, total = 0;
+    for (size_t i = 0; i < sample; ++i) {
+        for (const auto &slot : buckets[i].entries) {
+            uint64_t e = slot.load(std::memory_order_relaxed);
+            used += (e != 0 && entry_gen(e) == generation);
+            total++;
+        }
+    }
+    return total ? used * 1000 / total : 0;
+}
+
+} // namespace Engine
@@ -2,21 +2,141 @@
 #include "board.hpp"
 #include "movegen.hpp"
 #include "engine.hpp"
+#include "movepick.hpp"
 #include "attacks.hpp"
+#include "nnue.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <vector>
 
-TEST(EngineEval, MaterialBalance) {
-    init_attacks();
+// Count every heap allocation made by this test binary
+static std::atomic<size_t> allocationCount{0};
+
+void *operator new(std::size_t size) {
+    ++allocationCount;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+// The evaluation tests run on both weight sources: the compile-time defaults
+// and the runtime evalParams (holding the same defaults here)
+template <class Params>
+class EngineEvalPolicy : public testing::Test {};
+using EvalPolicies = testing::Types<Engine::DefaultEval, Engine::RuntimeEval>;
+TYPED_TEST_SUITE(EngineEvalPolicy, EvalPolicies);
+
+TYPED_TEST(EngineEvalPolicy, MaterialBalance) {
     Board b; b.bitboards.fill(0ULL);
     set_bit(b.bitboards[board_index(WHITE,KING)], sq_index('e','1'));
     set_bit(b.bitboards[board_index(BLACK,KING)], sq_index('e','8'));
     set_bit(b.bitboards[board_index(WHITE,QUEEN)], sq_index('d','1'));
     b.recompute_occupancy();
-    int eval = Engine::evaluate(b);
+    int eval = Engine::evaluate<TypeParam>(b);
     EXPECT_GT(eval, 800); // queen advantage should be large
 }
 
+// Scores of the generate-and-make evaluation these positions were checked
+// against: pins, discovered checks, en passant, promotions, castling and a
+// side to move that is in check
+TYPED_TEST(EngineEvalPolicy, AttackMapsMatchMoveGeneration) {
+    struct Case { const char *fen; int score; };
+    const Case cases[] = {
+        {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 172},
+        {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", -137},
+        {"8/2p5/3p4/KP5r/1R2Pp1k/8/6P1/8 b - e3 0 1", -47},
+        {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", -803},
+        {"3k4/2B1r1b1/q7/R7/P1P1p3/7b/2NR4/3K4 b - - 0 1", -40},
+        {"4k3/8/8/8/1b6/8/3P4/4K2R w K - 0 1", 389},
+    };
+    for (const Case &c : cases) {
+        Board b;
+        b.set_fen(c.fen);
+        EXPECT_EQ(Engine::evaluate<TypeParam>(b), c.score) << c.fen;
+    }
+}
+
+TEST(EngineEval, RuntimeWeightsOnlyWhenChanged) {
+    Board b;
+    b.set_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    int folded = Engine::evaluate<Engine::DefaultEval>(b);
+    EXPECT_EQ(Engine::evaluate(b), folded);
+
+    Engine::EvalParams saved = Engine::evalParams;
+    Engine::evalParams.mobilityWeight += 3;
+    EXPECT_EQ(Engine::evaluate(b), folded); // not told yet
+    Engine::eval_params_changed();
+    int tuned = Engine::evaluate<Engine::RuntimeEval>(b);
+    EXPECT_NE(tuned, folded);
+    EXPECT_EQ(Engine::evaluate(b), tuned);
+    EXPECT_EQ(Engine::evaluate<Engine::DefaultEval>(b), folded);
+    Engine::evalParams = saved;
+    Engine::eval_params_changed();
+    EXPECT_EQ(Engine::evaluate(b), folded);
+}
+
+TEST(EngineEval, BatchMatchesScalar) {
+    const char *fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "8/2p5/3p4/KP5r/1R2Pp1k/8/6P1/8 b - e3 0 1",
+        "4k3/8/8/8/1b6/8/3P4/4K2R w K - 0 1",
+    };
+    std::vector<Board> boards;
+    for (const char *fen : fens) {
+        Board b;
+        b.set_fen(fen);
+        boards.push_back(b);
+        for (const Move &m : generate_legal_moves(b)) {
+            Board c = b;
+            make_move(c, m);
+            boards.push_back(c);
+        }
+    }
+    boards.pop_back(); // not a multiple of the batch width
+    Engine::EvalParams saved = Engine::evalParams;
+    for (int run = 0; run < 2; run++) {
+        if (run == 1) { // negative and unusual weights
+            Engine::evalParams.spaceControlWeight = -7;
+            Engine::evalParams.kingSafetyWeight = 13;
+            Engine::evalParams.openFileBonus = -3;
+            Engine::eval_params_changed();
+        }
+        std::vector<int> out(boards.size());
+        Engine::evaluate_batch(boards.data(), boards.size(), out.data());
+        for (size_t i = 0; i < boards.size(); i++)
+            ASSERT_EQ(out[i], Engine::evaluate(boards[i])) << "position " << i << ", run " << run;
+    }
+    Engine::evalParams = saved;
+    Engine::eval_params_changed();
+}
+
+TYPED_TEST(EngineEvalPolicy, PawnHashHitsGiveSameScore) {
+    Board b;
+    b.set_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    Engine::clear_pawn_hash();
+    int cold = Engine::evaluate<TypeParam>(b);
+    int warm = Engine::evaluate<TypeParam>(b);
+    EXPECT_EQ(cold, warm);
+    EXPECT_EQ(Engine::pawn_hash_stats().probes, 2u);
+    EXPECT_EQ(Engine::pawn_hash_stats().hits, 1u);
+
+    // A piece move keeps the pawn key, a pawn move changes it
+    Board knight = b;
+    make_move(knight, parse_move("e5d3", knight));
+    EXPECT_EQ(knight.pawnKey, b.pawnKey);
+    Board pawn = b;
+    make_move(pawn, parse_move("a2a3", pawn));
+    EXPECT_NE(pawn.pawnKey, b.pawnKey);
+}
+
 TEST(EngineSearch, CaptureRook) {
-    init_attacks();
     Board b; b.bitboards.fill(0ULL);
     set_bit(b.bitboards[board_index(WHITE,KING)], sq_index('e','1'));
     set_bit(b.bitboards[board_index(WHITE,QUEEN)], sq_index('e','2'));
@@ -26,6 +146,464 @@ TEST(EngineSearch, CaptureRook) {
     b.recompute_occupancy();
     auto res = Engine::search(b,2);
     Move expected = parse_move("e2e5", b);
-    EXPECT_EQ(res.bestMove.from, expected.from);
-    EXPECT_EQ(res.bestMove.to, expected.to);
-}
\ No newline at end of file
+    EXPECT_EQ(res.bestMove.from(), expected.from());
+    EXPECT_EQ(res.bestMove.to(), expected.to());
+}
+
+TEST(EngineAlloc, NoHeapAllocationsInMoveGenAndEval) {
+    Board b;
+    b.set_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    size_t before = allocationCount.load();
+    uint64_t nodes = perft(b, 3);
+    int eval = Engine::evaluate(b);
+    size_t after = allocationCount.load();
+    EXPECT_EQ(nodes, 97862ULL);
+    EXPECT_NE(eval, 123456789); // keep the call from being optimised away
+    EXPECT_EQ(after - before, 0u);
+}
+
+TEST(EngineAlloc, NoHeapAllocationsInSearch) {
+    Board b;
+    b.set_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    Engine::search(b, 1); // allocates the transposition table on first use
+    size_t before = allocationCount.load();
+    auto res = Engine::search(b, 3);
+    size_t after = allocationCount.load();
+    EXPECT_GT(res.nodes, 0);
+    EXPECT_EQ(after - before, 0u);
+}
+
+TEST(EngineTT, StoreAndProbe) {
+    Engine::TranspositionTable table;
+    table.resize(1);
+    EXPECT_EQ(table.size_mb(), 1u);
+
+    Move m = Move::promotion_to(sq_index('e','7'), sq_index('e','8'), QUEEN);
+    U64 key = 0x123456789ABCDEF0ULL;
+    table.store(key, 7, Engine::BOUND_LOWER, -1234, m);
+
+    Engine::TTData hit;
+    ASSERT_TRUE(table.probe(key, hit));
+    EXPECT_EQ(hit.depth, 7);
+    EXPECT_EQ(hit.bound, Engine::BOUND_LOWER);
+    EXPECT_EQ(hit.score, -1234);
+    EXPECT_TRUE(hit.move == m);
+    EXPECT_FALSE(table.probe(key ^ (1ULL << 63), hit));
+
+    // Large scores survive the packing
+    table.store(key, 3, Engine::BOUND_EXACT, 100000, Move());
+    ASSERT_TRUE(table.probe(key, hit));
+    EXPECT_EQ(hit.score, 100000);
+    EXPECT_TRUE(hit.move == m); // move kept when none given
+
+    table.clear();
+    EXPECT_FALSE(table.probe(key, hit));
+}
+
+TEST(EngineTT, ReplacementPrefersStaleShallowEntries) {
+    Engine::TranspositionTable table;
+    table.resize(1);
+    // Fill one bucket (same low bits, different verification bits)
+    auto key = [](int i) { return (U64(i + 1) << 48) | 0x42ULL; };
+    for (int i = 0; i < Engine::TranspositionTable::BUCKET_ENTRIES; ++i)
+        table.store(key(i), 10 + i, Engine::BOUND_EXACT, i, Move());
+
+    // A new entry evicts the shallowest one
+    table.store(key(100), 1, Engine::BOUND_EXACT, 0, Move());
+    Engine::TTData hit;
+    EXPECT_FALSE(table.probe(key(0), hit));
+    EXPECT_TRUE(table.probe(key(100), hit));
+
+    // After a few searches the old deep entries become replaceable first
+    for (int i = 0; i < 3; ++i) table.new_search();
+    table.store(key(101), 1, Engine::BOUND_EXACT, 0, Move());
+    EXPECT_TRUE(table.probe(key(100), hit) || table.probe(key(1), hit));
+    EXPECT_TRUE(table.probe(key(101), hit));
+}
+
+TEST(EngineEval, LazyBoundsOutsideWindow) {
+    Board b;
+    b.set_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    int full = Engine::evaluate(b);
+    int margin = Engine::evalParams.lazyMargin;
+    // Inside the window, or too close to it, the full score comes back
+    EXPECT_EQ(Engine::evaluate(b, full - 10, full + 10), full);
+    EXPECT_EQ(Engine::evaluate(b, b.psqtScore - margin + 1, b.psqtScore + margin), full);
+    // Far outside it a bound on the right side of the window does
+    EXPECT_GE(Engine::evaluate(b, -20000, b.psqtScore - margin - 1), b.psqtScore - margin - 1);
+    EXPECT_LE(Engine::evaluate(b, b.psqtScore + margin + 1, 20000), b.psqtScore + margin + 1);
+}
+
+// Every position up to depth plies from b
+static void collect_positions(Board &b, int depth, std::vector<Board> &out) {
+    out.push_back(b);
+    if (depth == 0)
+        return;
+    for (const Move &m : generate_legal_moves(b)) {
+        Undo u = make_move(b, m);
+        collect_positions(b, depth - 1, out);
+        undo_move(b, m, u);
+    }
+}
+
+TEST(EngineEval, LazyMarginBoundsPositionalTerms) {
+    const char *fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        // tactical and lopsided positions
+        "r1b1k2r/ppppnppp/2n2q2/2b5/3NP3/2P1B3/PP3PPP/RN1QKB1R w KQkq - 0 1",
+        "2r3k1/pp3ppp/8/3Q4/8/8/PPP2PPP/2K1R3 b - - 0 1",
+        "4k3/8/8/8/8/8/8/QQQQKQQQ w - - 0 1",
+        "7k/8/1QQ1QQ2/8/1QQ1QQ2/8/8/K7 b - - 0 1", // 1218 uncapped
+        "1q1q1q1k/8/8/8/8/8/8/K7 w - - 0 1",
+        "k7/8/PPPPPPPP/8/8/8/8/K7 w - - 0 1",
+    };
+    std::vector<Board> boards;
+    for (const char *fen : fens) {
+        Board b;
+        b.set_fen(fen);
+        collect_positions(b, 2, boards);
+    }
+    int margin = Engine::evalParams.lazyMargin;
+    for (const Board &b : boards)
+        ASSERT_LE(std::abs(Engine::evaluate(b) - b.psqtScore), margin);
+
+    // The cap is what keeps the bound in the lopsided ones
+    Engine::EvalParams saved = Engine::evalParams;
+    Engine::evalParams.lazyMargin = 100000;
+    Engine::eval_params_changed();
+    int beyond = 0;
+    for (const Board &b : boards)
+        beyond += std::abs(Engine::evaluate(b) - b.psqtScore) > margin;
+    Engine::evalParams = saved;
+    Engine::eval_params_changed();
+    EXPECT_GT(beyond, 0);
+}
+
+TEST(EngineSearch, LazyEvalKeepsResult) {
+    const char *fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    };
+    Engine::SearchOptions saved = Engine::searchOptions;
+    for (const char *fen : fens) {
+        int scores[2];
+        for (bool on : {false, true}) {
+            Engine::searchOptions.lazyEval = on;
+            Board b;
+            b.set_fen(fen);
+            Engine::tt.clear();
+            Engine::evalCache.clear();
+            auto res = Engine::search(b, 4);
+            scores[on] = res.score;
+            if (!on) {
+                EXPECT_EQ(res.lazyEvals, 0) << fen;
+            }
+        }
+        EXPECT_NEAR(scores[1], scores[0], 30) << fen;
+    }
+    Engine::searchOptions = saved;
+}
+
+TEST(EngineEvalCache, StoreAndProbe) {
+    Engine::EvalCache cache;
+    cache.resize(64);
+    EXPECT_EQ(cache.size_kb(), 64u);
+
+    U64 key = 0x123456789ABCDEF0ULL;
+    int score = 0;
+    EXPECT_FALSE(cache.probe(key, score));
+    cache.store(key, -1234);
+    ASSERT_TRUE(cache.probe(key, score));
+    EXPECT_EQ(score, -1234);
+    EXPECT_FALSE(cache.probe(key ^ (1ULL << 63), score)); // same slot, other key
+
+    // Mate-sized scores survive the packing
+    cache.store(key, 100000);
+    ASSERT_TRUE(cache.probe(key, score));
+    EXPECT_EQ(score, 100000);
+
+    cache.clear();
+    EXPECT_FALSE(cache.probe(key, score));
+}
+
+TEST(EngineEvalCache, ClearedWhenEvalParamsChange) {
+    Board b;
+    b.set_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    Engine::SearchOptions options = Engine::searchOptions;
+    Engine::searchOptions.lazyEval = false; // lazy bounds are never cached
+    Engine::tt.clear();
+    Engine::evalCache.clear();
+    auto first = Engine::search(b, 2);
+    EXPECT_GT(first.evalCacheMisses, 0);
+
+    // Same search again: nearly every evaluation is already cached (a few
+    // may have been overwritten by positions sharing their slot)
+    Engine::tt.clear();
+    auto second = Engine::search(b, 2);
+    EXPECT_LT(second.evalCacheMisses * 20, first.evalCacheMisses);
+    EXPECT_GT(second.evalCacheHits, first.evalCacheMisses / 2);
+
+    // New weights make the cached scores stale
+    Engine::EvalParams saved = Engine::evalParams;
+    Engine::evalParams.mobilityWeight += 7;
+    Engine::tt.clear();
+    auto third = Engine::search(b, 2);
+    EXPECT_GT(third.evalCacheMisses, 0);
+    for (const auto &m : generate_legal_moves(b)) {
+        Board child = b;
+        make_move(child, m);
+        int cached = 0;
+        ASSERT_TRUE(Engine::evalCache.probe(child.key, cached)) << move_to_uci(m);
+        EXPECT_EQ(cached, Engine::evaluate(child)) << move_to_uci(m);
+    }
+    Engine::evalParams = saved;
+    Engine::eval_params_changed();
+    Engine::searchOptions = options;
+}
+
+// The network tests leave no network loaded behind them
+class EngineNNUE : public testing::Test {
+protected:
+    void TearDown() override { NNUE::unload(); }
+};
+
+// Walk every line of `depth` plies, checking the accumulators updated move
+// by move against a refresh and the score against psqtScore
+static void check_psqt_network(Board &b, const NNUE::Accumulator &acc, int depth) {
+    NNUE::Accumulator fresh;
+    NNUE::refresh(b, fresh);
+    ASSERT_EQ(std::memcmp(&fresh, &acc, sizeof(fresh)), 0);
+    ASSERT_EQ(NNUE::evaluate(b, acc), b.sideToMove == WHITE ? b.psqtScore : -b.psqtScore);
+    if (depth == 0) return;
+    for (const Move &m : generate_legal_moves(b)) {
+        Undo u = make_move(b, m);
+        NNUE::Accumulator next;
+        NNUE::update(acc, next, b, m, u.captured);
+        check_psqt_network(b, next, depth - 1);
+        undo_move(b, m, u);
+    }
+}
+
+TEST_F(EngineNNUE, AccumulatorsFollowMoves) {
+    NNUE::init_psqt_network();
+    ASSERT_TRUE(NNUE::loaded());
+    // Castling, en passant, promotions and captures of promoted pieces
+    const char *fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "8/2p5/3p4/KP5r/1R2Pp1k/8/6P1/8 b - e3 0 1",
+    };
+    for (const char *fen : fens) {
+        Board b;
+        b.set_fen(fen);
+        NNUE::Accumulator acc;
+        NNUE::refresh(b, acc);
+        check_psqt_network(b, acc, 3);
+    }
+}
+
+TEST_F(EngineNNUE, BackendsAgree) {
+    NNUE::init_psqt_network();
+    Board b;
+    b.set_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    NNUE::Backend saved = NNUE::backend();
+    ASSERT_TRUE(NNUE::set_backend(NNUE::BACKEND_SCALAR));
+    NNUE::Accumulator expected, acc;
+    NNUE::refresh(b, expected);
+    int score = NNUE::evaluate(b);
+    for (NNUE::Backend backend : {NNUE::BACKEND_SSE2, NNUE::BACKEND_AVX2}) {
+        if (!NNUE::set_backend(backend)) continue; // not supported here
+        NNUE::refresh(b, acc);
+        EXPECT_EQ(std::memcmp(&expected, &acc, sizeof(expected)), 0) << NNUE::backend_name();
+        EXPECT_EQ(NNUE::evaluate(b), score) << NNUE::backend_name();
+    }
+    NNUE::set_backend(saved);
+}
+
+TEST_F(EngineNNUE, SaveAndLoad) {
+    std::string path = testing::TempDir() + "psqt.nnue";
+    NNUE::init_psqt_network();
+    ASSERT_TRUE(NNUE::save(path));
+    uint32_t generation = NNUE::generation();
+    ASSERT_TRUE(NNUE::load(path));
+    EXPECT_NE(NNUE::generation(), generation);
+
+    Board b;
+    b.set_fen("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8");
+    EXPECT_EQ(NNUE::evaluate(b), b.psqtScore);
+
+    // Missing and truncated files are refused and keep the current network
+    EXPECT_FALSE(NNUE::load(path + ".missing"));
+    { std::ofstream(path, std::ios::binary) << "CENN"; }
+    EXPECT_FALSE(NNUE::load(path));
+    EXPECT_EQ(NNUE::evaluate(b), b.psqtScore);
+    std::remove(path.c_str());
+}
+
+TEST_F(EngineNNUE, SelectableEvaluator) {
+    NNUE::init_psqt_network();
+    Board b;
+    b.set_fen("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1"); // Ra8 is mate
+    int classical = Engine::evaluate(b);
+    Engine::evalParams.evaluator = Engine::EVAL_NNUE;
+    Engine::eval_params_changed();
+    EXPECT_EQ(Engine::evaluate(b), b.psqtScore);
+    auto res = Engine::search(b, 3);
+    Engine::evalParams.evaluator = Engine::EVAL_CLASSICAL;
+    Engine::eval_params_changed();
+    EXPECT_EQ(res.bestMove.to(), sq_index('a','8'));
+    EXPECT_GT(res.score, 90000);
+    EXPECT_EQ(Engine::evaluate(b), classical);
+}
+
+TEST(EngineSearch, LazySmpFindsMate) {
+    Board b;
+    b.set_fen("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1"); // Ra8 is mate
+    Engine::searchOptions.threads = 4;
+    auto res = Engine::search(b, 3);
+    Engine::searchOptions.threads = 1;
+    EXPECT_EQ(res.bestMove.from(), sq_index('a','1'));
+    EXPECT_EQ(res.bestMove.to(), sq_index('a','8'));
+    EXPECT_GT(res.score, 90000);
+}
+
+TEST(EngineSearch, MoveOrderingCutsOnFirstMove) {
+    Board b;
+    b.set_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    Engine::tt.clear();
+    auto res = Engine::search(b, 4);
+    ASSERT_GT(res.betaCutoffs, 0);
+    EXPECT_LE(res.firstMoveCutoffs, res.betaCutoffs);
+    // With TT move, MVV-LVA, killers and history most cutoffs come first
+    EXPECT_GT(res.firstMoveCutoffs * 10, res.betaCutoffs * 8);
+}
+
+TEST(EngineSearch, PrincipalVariationIsPlayable) {
+    Board b;
+    b.set_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    Engine::tt.clear();
+    auto res = Engine::search(b, 4);
+    ASSERT_EQ(res.pv.size(), 4u);
+    EXPECT_EQ(res.pv[0].from(), res.bestMove.from());
+    EXPECT_EQ(res.pv[0].to(), res.bestMove.to());
+    // Every move of the line must be legal in the position it is played from
+    for (const auto &m : res.pv) {
+        auto legal = generate_legal_moves(b);
+        bool found = false;
+        for (const auto &l : legal)
+            if (l.from() == m.from() && l.to() == m.to() && l.promotion() == m.promotion()) found = true;
+        ASSERT_TRUE(found);
+        make_move(b, m);
+    }
+}
+
+// Whatever TT move and killers it is given, the picker hands out every legal
+// move exactly once; the quiescence picker every capture that does not lose
+// material
+TEST(EngineMovePicker, HandsOutEveryMoveOnce) {
+    const char *fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "r3k2r/8/8/8/4q3/8/8/R3K2R w KQkq - 0 1", // in check
+    };
+    static Engine::HistoryTable history = {};
+    history[0][sq_index('g','2')][sq_index('h','3')] = 1000;
+    for (const char *fen : fens) {
+        Board b;
+        b.set_fen(fen);
+        MoveList legal = generate_legal_moves(b);
+        std::vector<uint16_t> expected;
+        for (Move m : legal) expected.push_back(m.data);
+        std::sort(expected.begin(), expected.end());
+        bool inCheck = b.is_square_attacked(b.king_square(b.sideToMove), Color(-b.sideToMove));
+
+        Move garbage = Move(sq_index('d','4'), sq_index('d','5'), Move::DOUBLE_PUSH);
+        Move quiet = legal[0], capture = legal[0];
+        for (Move m : legal) {
+            if (Engine::is_quiet(b, m)) quiet = m;
+            else capture = m;
+        }
+        Move ttMoves[] = {Move(), garbage, quiet, capture};
+        for (Move tt : ttMoves) {
+            Move killers[2] = {quiet, garbage};
+            int generations = 0;
+            Engine::MovePicker picker(b, tt, killers, history, inCheck, generations);
+            std::vector<uint16_t> got;
+            for (Move m; !(m = picker.next()).is_none(); ) got.push_back(m.data);
+            std::sort(got.begin(), got.end());
+            EXPECT_EQ(got, expected) << fen << " tt " << move_to_uci(tt);
+            EXPECT_LE(generations, 2);
+        }
+
+        int generations = 0;
+        Engine::MovePicker qpicker(b, generations);
+        std::vector<uint16_t> got, wanted;
+        for (Move m; !(m = qpicker.next()).is_none(); ) got.push_back(m.data);
+        MoveList captures;
+        generate_moves<CAPTURES>(b, captures);
+        for (Move m : captures)
+            if (Engine::see(b, m) >= 0) wanted.push_back(m.data);
+        std::sort(got.begin(), got.end());
+        std::sort(wanted.begin(), wanted.end());
+        EXPECT_EQ(got, wanted) << fen;
+        EXPECT_EQ(generations, 1);
+    }
+}
+
+// A valid TT move is searched without generating anything first
+TEST(EngineMovePicker, TTMoveBeforeGeneration) {
+    Board b;
+    b.init_startpos();
+    Engine::HistoryTable history = {};
+    int generations = 0;
+    Move tt = parse_move("e2e4", b);
+    Engine::MovePicker picker(b, tt, nullptr, history, false, generations);
+    EXPECT_TRUE(picker.next() == tt);
+    EXPECT_EQ(generations, 0);
+    picker.next();
+    EXPECT_EQ(generations, 2); // no captures, then the quiets
+}
+
+TEST(EngineSearch, PruningSwitchesKeepTactics) {
+    Engine::SearchOptions saved = Engine::searchOptions;
+    for (bool on : {false, true}) {
+        Engine::searchOptions.nullMove = on;
+        Engine::searchOptions.lateMoveReductions = on;
+        Engine::searchOptions.futilityPruning = on;
+        Engine::searchOptions.reverseFutilityPruning = on;
+        Engine::searchOptions.lateMovePruning = on;
+        Board b;
+        b.set_fen("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1"); // Ra8 is mate
+        Engine::tt.clear();
+        auto res = Engine::search(b, 5);
+        EXPECT_EQ(res.bestMove.to(), sq_index('a','8')) << "pruning " << on;
+        EXPECT_GT(res.score, 90000) << "pruning " << on;
+    }
+    Engine::searchOptions = saved;
+}
+
+TEST(EngineSEE, ExchangeSequences) {
+    Board b;
+    // Undefended pawn
+    b.set_fen("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1");
+    EXPECT_EQ(Engine::see(b, parse_move("e1e5", b)), 100);
+
+    // Pawn defended by a rook, but a second rook x-rays through the first
+    b.set_fen("4r1k1/8/8/4p3/8/8/4R3/4R1K1 w - - 0 1");
+    EXPECT_EQ(Engine::see(b, parse_move("e2e5", b)), 100);
+
+    // Knight takes a pawn defended by a knight, x-rays behind on both sides:
+    // the knight is lost for the pawn
+    b.set_fen("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1");
+    EXPECT_LT(Engine::see(b, parse_move("d3e5", b)), 0);
+
+    // Queen takes a pawn defended by a pawn
+    b.set_fen("4k3/8/3p4/4p3/8/8/8/4QK2 w - - 0 1");
+    EXPECT_EQ(Engine::see(b, parse_move("e1e5", b)), 100 - 929);
+}
@@ -1,27 +1,27 @@
+#include <algorithm>
 #include <iostream>
+#include <vector>
 #include <gtest/gtest.h>
 #include "board.hpp"
 #include "movegen.hpp"
 #include "attacks.hpp"
 
-static bool contains_move(const std::vector<Move>& moves, const std::string& uci, const Board& b){
+static bool contains_move(const MoveList& moves, const std::string& uci, const Board& b){
     Move cmp = parse_move(uci,b);
     for(const auto& m : moves){
-        if(m.from==cmp.from && m.to==cmp.to && m.promotion==cmp.promotion && m.isCastling==cmp.isCastling && m.isEnPassant==cmp.isEnPassant)
+        if(m.from()==cmp.from() && m.to()==cmp.to() && m.promotion()==cmp.promotion() && m.is_castling()==cmp.is_castling() && m.is_en_passant()==cmp.is_en_passant())
             return true;
     }
     return false;
 }
 
 TEST(MoveGen, StartPosition) {
-    init_attacks();
     Board b; b.init_startpos();
     auto moves = generate_legal_moves(b);
     EXPECT_EQ(moves.size(), 20);
 }
 
 TEST(MoveGen, KingMoves) {
-    init_attacks();
     Board b; b.bitboards.fill(0ULL); b.recompute_occupancy();
     set_bit(b.bitboards[board_index(WHITE,KING)], sq_index('e','1'));
     set_bit(b.bitboards[board_index(BLACK,KING)], sq_index('e','3'));
@@ -33,7 +33,6 @@ TEST(MoveGen, KingMoves) {
 }
 
 TEST(MoveGen, Checkmate) {
-    init_attacks();
     Board b; b.bitboards.fill(0ULL);
     set_bit(b.bitboards[board_index(WHITE,KING)], sq_index('h','1'));
     set_bit(b.bitboards[board_index(BLACK,QUEEN)], sq_index('g','2'));
@@ -45,7 +44,6 @@ TEST(MoveGen, Checkmate) {
 }
 
 TEST(MoveGen, EnPassant) {
-    init_attacks();
     Board b; b.bitboards.fill(0ULL);
     set_bit(b.bitboards[board_index(WHITE,KING)], sq_index('a','1'));
     set_bit(b.bitboards[board_index(BLACK,KING)], sq_index('h','8'));
@@ -59,7 +57,6 @@ TEST(MoveGen, EnPassant) {
 }
 
 TEST(MoveGen, Stalemate) {
-    init_attacks();
     Board b; b.bitboards.fill(0ULL);
     set_bit(b.bitboards[board_index(WHITE,KING)], sq_index('f','6'));
     set_bit(b.bitboards[board_index(WHITE,QUEEN)], sq_index('g','6'));
@@ -71,7 +68,6 @@ TEST(MoveGen, Stalemate) {
 }
 
 TEST(MoveGen, CastlingLegal) {
-    init_attacks();
     Board b; b.bitboards.fill(0ULL);
     set_bit(b.bitboards[board_index(WHITE,KING)], sq_index('e','1'));
     set_bit(b.bitboards[board_index(WHITE,ROOK)], sq_index('h','1'));
@@ -84,7 +80,6 @@ TEST(MoveGen, CastlingLegal) {
 }
 
 TEST(MoveGen, CastlingIllegal) {
-    init_attacks();
     Board b; b.bitboards.fill(0ULL);
     set_bit(b.bitboards[board_index(WHITE,KING)], sq_index('e','1'));
     set_bit(b.bitboards[board_index(WHITE,ROOK)], sq_index('h','1'));
@@ -98,7 +93,6 @@ TEST(MoveGen, CastlingIllegal) {
 }
 
 TEST(MoveGen, PlaySequence) {
-    init_attacks();
     Board b; b.init_startpos();
     std::vector<std::string> seq = {"e2e4","e7e5","g1f3","b8c6","f1c4","f8c5","b1c3","g8f6","e1g1","e8g8"};
     for(const auto& mv : seq){
@@ -107,7 +101,7 @@ TEST(MoveGen, PlaySequence) {
         Move m = parse_move(mv,b);
         // replace with the fully defined move from legal list
         for(const auto& l : legal){
-            if(l.from==m.from && l.to==m.to && l.promotion==m.promotion && l.isCastling==m.isCastling && l.isEnPassant==m.isEnPassant){
+            if(l.from()==m.from() && l.to()==m.to() && l.promotion()==m.promotion() && l.is_castling()==m.is_castling() && l.is_en_passant()==m.is_en_passant()){
                 m = l; break;
             }
         }
@@ -116,7 +110,6 @@ TEST(MoveGen, PlaySequence) {
 }
 
 TEST(MoveGen, EnPassantSequence) {
-    init_attacks();
     Board b; b.init_startpos();
     std::vector<std::string> seq = {"e2e4","a7a5","e4e5","d7d5"};
     for(const auto& mv : seq){
@@ -124,7 +117,7 @@ TEST(MoveGen, EnPassantSequence) {
         ASSERT_TRUE(contains_move(legal,mv,b)) << "Illegal move in sequence: " << mv;
         Move m = parse_move(mv,b);
         for(const auto& l : legal){
-            if(l.from==m.from && l.to==m.to && l.promotion==m.promotion && l.isCastling==m.isCastling && l.isEnPassant==m.isEnPassant){
+            if(l.from()==m.from() && l.to()==m.to() && l.promotion()==m.promotion() && l.is_castling()==m.is_castling() && l.is_en_passant()==m.is_en_passant()){
                 m = l; break;
             }
         }
@@ -136,7 +129,6 @@ TEST(MoveGen, EnPassantSequence) {
 }
 
 TEST(MoveGen, KingCheckmate) {
-    init_attacks();
     Board b; b.init_startpos();
     std::vector<std::string> seq = {"e2e4","e7e5","f1c4","c7c5","d1f3", "a7a5", "f3f7"};
     for(const auto& mv : seq){
@@ -144,7 +136,7 @@ TEST(MoveGen, KingCheckmate) {
         ASSERT_TRUE(contains_move(legal,mv,b)) << "Illegal move in sequence: " << mv;
         Move m = parse_move(mv,b);
         for(const auto& l : legal){
-            if(l.from==m.from && l.to==m.to && l.promotion==m.promotion && l.isCastling==m.isCastling && l.isEnPassant==m.isEnPassant){
+            if(l.from()==m.from() && l.to()==m.to() && l.promotion()==m.promotion() && l.is_castling()==m.is_castling() && l.is_en_passant()==m.is_en_passant()){
                 m = l; break;
             }
         }
@@ -156,7 +148,6 @@ TEST(MoveGen, KingCheckmate) {
 }
 
 TEST(MoveGen, PawnPromotion) {
-    init_attacks();
     Board b; b.bitboards.fill(0ULL);
     set_bit(b.bitboards[board_index(WHITE,KING)], sq_index('h','1'));
     set_bit(b.bitboards[board_index(BLACK,KING)], sq_index('h','8'));
@@ -172,7 +163,6 @@ TEST(MoveGen, PawnPromotion) {
 }
 
 TEST(MoveGen, IllegalMoveInCheck) {
-    init_attacks();
     Board b; b.init_startpos();
     std::vector<std::string> seq = {
         "a2a4","e7e5","b2b4","d8h4","d2d4","d7d6",
@@ -185,7 +175,7 @@ TEST(MoveGen, IllegalMoveInCheck) {
         ASSERT_TRUE(contains_move(legal,mv,b)) << "Illegal move in sequence: " << mv;
         Move m = parse_move(mv,b);
         for(const auto &l : legal){
-            if(l.from==m.from && l.to==m.to && l.promotion==m.promotion && l.isCastling==m.isCastling && l.isEnPassant==m.isEnPassant){
+            if(l.from()==m.from() && l.to()==m.to() && l.promotion()==m.promotion() && l.is_castling()==m.is_castling() && l.is_en_passant()==m.is_en_passant()){
                 m = l; break;
             }
         }
@@ -196,7 +186,6 @@ TEST(MoveGen, IllegalMoveInCheck) {
 }
 
 TEST(MoveGen, KingReturnF2F1) {
-    init_attacks();
     Board b; b.init_startpos();
     std::vector<std::string> seq = {
         "e2e4","g8f6","b1c3","b8c6","g1f3","c6b4","a2a3","b4c6",
@@ -209,7 +198,7 @@ TEST(MoveGen, KingReturnF2F1) {
         ASSERT_TRUE(contains_move(legal,mv,b)) << "Illegal move in sequence: " << mv;
         Move m = parse_move(mv,b);
         for(const auto &l : legal){
-            if(l.from==m.from && l.to==m.to && l.promotion==m.promotion && l.isCastling==m.isCastling && l.isEnPassant==m.isEnPassant){
+            if(l.from()==m.from() && l.to()==m.to() && l.promotion()==m.promotion() && l.is_castling()==m.is_castling() && l.is_en_passant()==m.is_en_passant()){
                 m = l; break;
             }
         }
@@ -217,4 +206,330 @@ TEST(MoveGen, KingReturnF2F1) {
     }
     auto legal = generate_legal_moves(b);
     EXPECT_TRUE(contains_move(legal,"f2f1",b));
-}
\ No newline at end of file
+}
+TEST(MoveGen, SliderAttacks) {
+    // Rook on d4 blocked on d6 and f4, open towards a4 and d1
+    U64 occ = 0ULL;
+    set_bit(occ, sq_index('d','6'));
+    set_bit(occ, sq_index('f','4'));
+    U64 expected = 0ULL;
+    for (int sq : {sq_index('d','5'), sq_index('d','6'), sq_index('d','3'), sq_index('d','2'),
+                   sq_index('d','1'), sq_index('e','4'), sq_index('f','4'), sq_index('c','4'),
+                   sq_index('b','4'), sq_index('a','4')})
+        set_bit(expected, sq);
+    EXPECT_EQ(rook_attacks(sq_index('d','4'), occ), expected);
+
+    // Bishop on a1 sees the whole long diagonal until the blocker on f6
+    set_bit(occ, sq_index('f','6'));
+    expected = 0ULL;
+    for (int sq : {sq_index('b','2'), sq_index('c','3'), sq_index('d','4'),
+                   sq_index('e','5'), sq_index('f','6')})
+        set_bit(expected, sq);
+    EXPECT_EQ(bishop_attacks(sq_index('a','1'), occ), expected);
+}
+
+TEST(MoveGen, Perft) {
+    Board b; b.init_startpos();
+    EXPECT_EQ(perft(b, 3), 8902ULL);
+
+    b.set_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    EXPECT_EQ(perft(b, 3), 97862ULL);
+
+    b.set_fen("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1");
+    EXPECT_EQ(perft(b, 4), 43238ULL);
+
+    b.set_fen("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1");
+    EXPECT_EQ(perft(b, 3), 9467ULL);
+
+    b.set_fen("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8");
+    EXPECT_EQ(perft(b, 3), 62379ULL);
+}
+
+TEST(MoveGen, PinnedPieces) {
+    Board b;
+    // The e2 knight is pinned by the e8 rook, the d2 bishop may only slide
+    // along the pin towards the a5 queen
+    b.set_fen("4r2k/8/8/q7/8/8/3BN3/4K3 w - - 0 1");
+    auto moves = generate_legal_moves(b);
+    for (const auto &m : moves)
+        EXPECT_NE(m.from(), sq_index('e','2'));
+    EXPECT_TRUE(contains_move(moves, "d2c3", b));
+    EXPECT_TRUE(contains_move(moves, "d2a5", b));
+    EXPECT_FALSE(contains_move(moves, "d2e3", b));
+}
+
+TEST(MoveGen, EnPassantDiscoveredCheck) {
+    Board b;
+    // Capturing en passant would remove both pawns from the fourth rank and
+    // expose the black king to the queen on h4
+    b.set_fen("8/8/8/8/k2Pp2Q/8/8/3K4 b - d3 0 1");
+    auto moves = generate_legal_moves(b);
+    EXPECT_FALSE(contains_move(moves, "e4d3", b));
+    EXPECT_TRUE(contains_move(moves, "e4e3", b));
+
+    // Capturing the checking pawn en passant is a legal evasion
+    b.set_fen("8/8/8/2k5/2pP4/8/B7/4K3 b - d3 0 1");
+    moves = generate_legal_moves(b);
+    EXPECT_TRUE(contains_move(moves, "c4d3", b));
+}
+
+TEST(MoveGen, SliderBackendsAgree) {
+    if (!pext_supported()) {
+        EXPECT_FALSE(set_slider_backend(SLIDER_PEXT));
+        GTEST_SKIP() << "CPU has no BMI2, only the magic backend is available";
+    }
+
+    // Sample random occupancies and compare both kernels square by square
+    U64 state = 0x9E3779B97F4A7C15ULL;
+    auto next = [&state]() {
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        return state;
+    };
+    std::vector<U64> occs;
+    for (int i = 0; i < 64; ++i) occs.push_back(next() & next());
+
+    std::vector<U64> magic;
+    ASSERT_TRUE(set_slider_backend(SLIDER_MAGIC));
+    for (U64 occ : occs)
+        for (int sq = 0; sq < 64; ++sq)
+            magic.push_back(queen_attacks(sq, occ));
+
+    ASSERT_TRUE(set_slider_backend(SLIDER_PEXT));
+    EXPECT_EQ(slider_backend(), SLIDER_PEXT);
+    size_t i = 0;
+    for (U64 occ : occs)
+        for (int sq = 0; sq < 64; ++sq, ++i) {
+            EXPECT_EQ(queen_attacks(sq, occ), magic[i]);
+            EXPECT_EQ(rook_attacks(sq, occ) | bishop_attacks(sq, occ), magic[i]);
+        }
+}
+
+TEST(MoveGen, BetweenAndLine) {
+    // Leaper tables are usable in constant expressions
+    static_assert(knightAttacks[0] == ((1ULL << 10) | (1ULL << 17)), "knight on a1");
+    static_assert(pawnAttacks[0][8] == (1ULL << 17), "white pawn on a2");
+
+    int a1 = sq_index('a','1'), d4 = sq_index('d','4'), h8 = sq_index('h','8');
+    int e1 = sq_index('e','1'), e8 = sq_index('e','8'), b3 = sq_index('b','3');
+
+    U64 expected = 0ULL;
+    set_bit(expected, sq_index('b','2'));
+    set_bit(expected, sq_index('c','3'));
+    EXPECT_EQ(between[a1][d4], expected);
+    EXPECT_EQ(between[d4][a1], expected);
+    EXPECT_EQ(between[a1][sq_index('b','2')], 0ULL);
+    EXPECT_EQ(between[a1][b3], 0ULL); // not aligned
+    EXPECT_EQ(__builtin_popcountll(between[e1][e8]), 6);
+
+    EXPECT_EQ(line[a1][d4], line[d4][h8]);
+    EXPECT_EQ(__builtin_popcountll(line[a1][d4]), 8);
+    EXPECT_TRUE(test_bit(line[e1][sq_index('e','4')], e8));
+    EXPECT_EQ(line[a1][b3], 0ULL);
+}
+
+// Walk the tree and compare the incrementally updated board with one rebuilt
+// from scratch after every make and undo
+static void check_incremental(Board &b, int depth) {
+    Board fresh = b;
+    fresh.recompute_occupancy();
+    ASSERT_EQ(b.whiteOccupancy, fresh.whiteOccupancy);
+    ASSERT_EQ(b.blackOccupancy, fresh.blackOccupancy);
+    ASSERT_EQ(b.bothOccupancy, fresh.bothOccupancy);
+    ASSERT_EQ(b.mailbox, fresh.mailbox);
+    ASSERT_EQ(b.key, b.compute_key());
+    ASSERT_EQ(b.pawnKey, b.compute_pawn_key());
+    ASSERT_EQ(b.psqtScore, b.compute_psqt());
+    if (depth == 0) return;
+    for (const auto &m : generate_legal_moves(b)) {
+        Board before = b;
+        Undo u = make_move(b, m);
+        check_incremental(b, depth - 1);
+        undo_move(b, m, u);
+        ASSERT_EQ(b.bitboards, before.bitboards);
+        ASSERT_EQ(b.mailbox, before.mailbox);
+        ASSERT_EQ(b.key, before.key);
+        ASSERT_EQ(b.pawnKey, before.pawnKey);
+        ASSERT_EQ(b.psqtScore, before.psqtScore);
+    }
+}
+
+TEST(MoveGen, ZobristTransposition) {
+    // The same position reached by different move orders hashes identically
+    auto play = [](const std::vector<std::string> &seq) {
+        Board b; b.init_startpos();
+        for (const auto &mv : seq) {
+            for (const auto &l : generate_legal_moves(b)) {
+                Move m = parse_move(mv, b);
+                if (l.from() == m.from() && l.to() == m.to() && l.promotion() == m.promotion()) {
+                    make_move(b, l);
+                    break;
+                }
+            }
+        }
+        return b.key;
+    };
+    U64 a = play({"g1f3","g8f6","b1c3","b8c6"});
+    U64 c = play({"b1c3","b8c6","g1f3","g8f6"});
+    EXPECT_EQ(a, c);
+    EXPECT_NE(a, play({"g1f3","g8f6","b1c3"}));
+
+    // Side to move, castling rights and the en passant file are all hashed
+    Board b; b.init_startpos();
+    U64 start = b.key;
+    b.sideToMove = BLACK; b.recompute_occupancy();
+    EXPECT_NE(b.key, start);
+    b.sideToMove = WHITE; b.w_can_castle_k = false; b.recompute_occupancy();
+    EXPECT_NE(b.key, start);
+    b.w_can_castle_k = true; b.enPassantSquare = sq_index('e','3'); b.recompute_occupancy();
+    EXPECT_NE(b.key, start);
+}
+
+TEST(MoveGen, IncrementalMakeUndo) {
+    Board b;
+    b.set_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    check_incremental(b, 2);
+    b.set_fen("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1");
+    check_incremental(b, 2);
+}
+
+TEST(MoveGen, NullMoveRestoresBoard) {
+    Board b;
+    b.set_fen("rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3");
+    Board before = b;
+    Undo u = make_null_move(b);
+    EXPECT_EQ(b.sideToMove, BLACK);
+    EXPECT_EQ(b.enPassantSquare, -1);
+    EXPECT_EQ(b.key, b.compute_key());
+    undo_null_move(b, u);
+    EXPECT_EQ(b.sideToMove, before.sideToMove);
+    EXPECT_EQ(b.enPassantSquare, before.enPassantSquare);
+    EXPECT_EQ(b.key, before.key);
+}
+
+TEST(MoveGen, AttackersTo) {
+    Board b;
+    b.set_fen("4r1k1/8/8/4p3/3P4/5N2/4R3/4R1K1 w - - 0 1");
+    int e5 = sq_index('e','5');
+    U64 expected = (1ULL << sq_index('d','4')) | (1ULL << sq_index('f','3')) |
+                   (1ULL << sq_index('e','2')) | (1ULL << sq_index('e','8'));
+    EXPECT_EQ(b.attackers_to(e5, b.bothOccupancy), expected);
+    // Lifting the front rook reveals the one behind it
+    U64 occ = b.bothOccupancy & ~(1ULL << sq_index('e','2'));
+    EXPECT_TRUE(b.attackers_to(e5, occ) & (1ULL << sq_index('e','1')));
+    // Against every piece of both colours, agree with is_square_attacked
+    for (int sq = 0; sq < 64; ++sq) {
+        U64 att = b.attackers_to(sq, b.bothOccupancy);
+        EXPECT_EQ(bool(att & b.whiteOccupancy), b.is_square_attacked(sq, WHITE)) << sq;
+        EXPECT_EQ(bool(att & b.blackOccupancy), b.is_square_attacked(sq, BLACK)) << sq;
+    }
+}
+
+// CAPTURES and QUIETS split the legal moves exactly, and EVASIONS matches
+// them while in check
+static void check_gen_types(Board &b, int depth) {
+    MoveList all, caps, quiets;
+    generate_legal_moves(b, all);
+    generate_moves<CAPTURES>(b, caps);
+    generate_moves<QUIETS>(b, quiets);
+    ASSERT_EQ(caps.size() + quiets.size(), all.size());
+    auto same = [](const Move &x, const Move &y) {
+        return x.from() == y.from() && x.to() == y.to() && x.promotion() == y.promotion();
+    };
+    for (const Move &m : all) {
+        bool capture = b.piece_type_at(m.to()) != NO_PIECE || m.is_en_passant() || m.promotion() != NO_PIECE;
+        const MoveList &part = capture ? caps : quiets;
+        ASSERT_TRUE(std::any_of(part.begin(), part.end(), [&](const Move &x) { return same(x, m); }));
+    }
+    int ksq = b.king_square(b.sideToMove);
+    if (b.is_square_attacked(ksq, (Color)(-b.sideToMove))) {
+        MoveList evasions;
+        generate_moves<EVASIONS>(b, evasions);
+        ASSERT_EQ(evasions.size(), all.size());
+    }
+    if (depth == 0) return;
+    for (const Move &m : all) {
+        Undo u = make_move(b, m);
+        check_gen_types(b, depth - 1);
+        undo_move(b, m, u);
+    }
+}
+
+TEST(MoveGen, GenerationTypes) {
+    const char *fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    };
+    for (const char *fen : fens) {
+        Board b;
+        b.set_fen(fen);
+        check_gen_types(b, 2);
+    }
+}
+
+// Every generated move survives a trip through its UCI string, and the
+// pieces read off the board match what the move does to it
+TEST(MoveGen, PackedMoves) {
+    static_assert(sizeof(Move) == 2, "Move is 16 bits");
+    EXPECT_EQ(move_to_uci(Move()), "0000");
+    const char *fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    };
+    for (const char *fen : fens) {
+        Board b;
+        b.set_fen(fen);
+        for (Move m : generate_legal_moves(b)) {
+            std::string uci = move_to_uci(m);
+            EXPECT_TRUE(parse_move(uci, b) == m) << fen << " " << uci;
+            PieceType piece = m.piece(b), captured = m.captured(b);
+            Color them = (Color)(-b.sideToMove);
+            int before = __builtin_popcountll(b.bitboards[board_index(them, captured == NO_PIECE ? PAWN : captured)]);
+            Undo u = make_move(b, m);
+            EXPECT_EQ(b.piece_type_at(m.to()), m.promotion() != NO_PIECE ? m.promotion() : piece) << uci;
+            if (captured != NO_PIECE) {
+                EXPECT_EQ(__builtin_popcountll(b.bitboards[board_index(them, captured)]), before - 1) << uci;
+            }
+            undo_move(b, m, u);
+        }
+    }
+    EXPECT_EQ(move_to_uci(Move::promotion_to(sq_index('g','7'), sq_index('h','8'), KNIGHT)), "g7h8n");
+}
+
+// Every 16-bit move word passes is_pseudo_legal and is_legal exactly when
+// it is generated, here and one ply further
+static void check_move_validation(Board &b, int depth) {
+    MoveList legal;
+    generate_legal_moves(b, legal);
+    for (int data = 1; data < 1 << 16; ++data) {
+        Move m;
+        m.data = uint16_t(data);
+        bool generated = std::find(legal.begin(), legal.end(), m) != legal.end();
+        bool valid = is_pseudo_legal(b, m) && is_legal(b, m);
+        ASSERT_EQ(valid, generated) << move_to_uci(m) << " flag " << m.flag();
+    }
+    if (depth == 0) return;
+    for (Move m : legal) {
+        Undo u = make_move(b, m);
+        check_move_validation(b, depth - 1);
+        undo_move(b, m, u);
+    }
+}
+
+TEST(MoveGen, PseudoLegalMatchesGeneration) {
+    const char *fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+        "8/8/8/8/k2Pp2Q/8/8/3K4 b - d3 0 1",
+        "r3k2r/8/8/8/4q3/8/8/R3K2R w KQkq - 0 1",
+    };
+    for (const char *fen : fens) {
+        Board b;
+        b.set_fen(fen);
+        check_move_validation(b, 1);
+    }
+}